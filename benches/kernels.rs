@@ -0,0 +1,116 @@
+//! Criterion benchmarks for the hot counting kernels.
+//!
+//! Each kernel runs against the input shapes production actually sees:
+//! ASCII logs, UTF-8 JSON, binary-ish data, and pathological one-byte
+//! lines. Results land in `target/criterion/`; `ci/bench_gate.py` distills
+//! them into `bench_output.txt` and fails CI on >5% regressions.
+
+use std::time::Duration;
+
+use criterion::{criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use wc::counts::{Counter, Selection};
+use wc::kernel;
+
+const INPUT_LEN: usize = 4 * 1024 * 1024;
+
+fn ascii_log() -> Vec<u8> {
+    let line =
+        b"192.168.4.17 - - [01/Sep/2026:10:00:00 +0000] \"GET /api/v1/items HTTP/1.1\" 200 4523\n";
+    line.iter().copied().cycle().take(INPUT_LEN).collect()
+}
+
+fn utf8_json() -> Vec<u8> {
+    let line = "{\"id\":42,\"name\":\"ünïcode-çhars\",\"note\":\"日本語テキスト\",\"tags\":[\"α\",\"β\"]}\n";
+    line.bytes().cycle().take(INPUT_LEN).collect()
+}
+
+fn binaryish() -> Vec<u8> {
+    // Deterministic pseudo-random bytes: every class (separator, printable,
+    // continuation, neutral) appears, so branchy classifiers can't settle.
+    let mut state = 0x2545_f491_4f6c_dd1du64;
+    (0..INPUT_LEN)
+        .map(|_| {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            state as u8
+        })
+        .collect()
+}
+
+fn one_byte_lines() -> Vec<u8> {
+    vec![b'\n'; INPUT_LEN]
+}
+
+fn shapes() -> Vec<(&'static str, Vec<u8>)> {
+    vec![
+        ("ascii_log", ascii_log()),
+        ("utf8_json", utf8_json()),
+        ("binary", binaryish()),
+        ("one_byte_lines", one_byte_lines()),
+    ]
+}
+
+fn count_with(selection: Selection, data: &[u8]) -> u64 {
+    let mut counter = Counter::new(selection);
+    counter.feed(data);
+    let counts = counter.finish();
+    counts.lines + counts.words + counts.chars + counts.max_line_length
+}
+
+fn bench_kernels(c: &mut Criterion) {
+    let selections = [
+        (
+            "words",
+            Selection {
+                words: true,
+                ..Selection::default()
+            },
+        ),
+        (
+            "chars",
+            Selection {
+                chars: true,
+                ..Selection::default()
+            },
+        ),
+        (
+            "max_line_length",
+            Selection {
+                max_line_length: true,
+                ..Selection::default()
+            },
+        ),
+    ];
+
+    for (shape, data) in shapes() {
+        let mut group = c.benchmark_group(shape);
+        group.throughput(Throughput::Bytes(data.len() as u64));
+
+        group.bench_with_input(BenchmarkId::new("newlines", INPUT_LEN), &data, |b, data| {
+            b.iter(|| kernel::count_byte(data, b'\n'))
+        });
+        for (name, selection) in selections {
+            group.bench_with_input(BenchmarkId::new(name, INPUT_LEN), &data, |b, data| {
+                b.iter(|| count_with(selection, data))
+            });
+        }
+        group.finish();
+    }
+}
+
+fn configured() -> Criterion {
+    // Short, fixed-budget runs: the CI gate compares medians and shared
+    // runners are noisy, so more samples buy little.
+    Criterion::default()
+        .sample_size(20)
+        .warm_up_time(Duration::from_millis(300))
+        .measurement_time(Duration::from_secs(2))
+}
+
+criterion_group! {
+    name = benches;
+    config = configured();
+    targets = bench_kernels
+}
+criterion_main!(benches);
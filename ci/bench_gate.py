@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+"""Distill criterion results into bench_output.txt and gate regressions.
+
+Usage: bench_gate.py [BASELINE]
+
+Reads median estimates from target/criterion/**/new/estimates.json and
+writes one tab-separated line per benchmark to bench_output.txt:
+
+    <benchmark id>\t<median ns/iter>\t<GB/s>
+
+If BASELINE points at a bench_output.txt from an earlier run, any benchmark
+more than 5% slower than its baseline median fails the gate. Benchmarks
+missing from the baseline (new ones) pass.
+"""
+
+import json
+import os
+import sys
+
+CRITERION_DIR = os.path.join("target", "criterion")
+OUTPUT = "bench_output.txt"
+THRESHOLD = 1.05
+
+
+def input_bytes(bench_id):
+    """Benchmark ids end with the input length (e.g. ascii_log/words/4194304)."""
+    tail = bench_id.rsplit("/", 1)[-1]
+    return int(tail) if tail.isdigit() else None
+
+
+def collect():
+    results = {}
+    for root, _dirs, files in os.walk(CRITERION_DIR):
+        if os.path.basename(root) != "new" or "estimates.json" not in files:
+            continue
+        with open(os.path.join(root, "estimates.json")) as fh:
+            estimates = json.load(fh)
+        bench_dir = os.path.dirname(root)
+        with open(os.path.join(bench_dir, "new", "benchmark.json")) as fh:
+            bench_id = json.load(fh)["full_id"]
+        results[bench_id] = estimates["median"]["point_estimate"]
+    return results
+
+
+def load_baseline(path):
+    baseline = {}
+    with open(path) as fh:
+        for line in fh:
+            fields = line.rstrip("\n").split("\t")
+            if len(fields) >= 2:
+                baseline[fields[0]] = float(fields[1])
+    return baseline
+
+
+def main():
+    results = collect()
+    if not results:
+        print(f"bench_gate: no criterion results under {CRITERION_DIR}", file=sys.stderr)
+        return 1
+
+    with open(OUTPUT, "w") as fh:
+        for bench_id in sorted(results):
+            median_ns = results[bench_id]
+            size = input_bytes(bench_id)
+            if size is None:
+                fh.write(f"{bench_id}\t{median_ns:.1f}\t-\n")
+            else:
+                gbps = size / median_ns  # bytes/ns == GB/s
+                fh.write(f"{bench_id}\t{median_ns:.1f}\t{gbps:.2f}\n")
+    print(f"bench_gate: wrote {len(results)} results to {OUTPUT}")
+
+    if len(sys.argv) < 2 or not os.path.exists(sys.argv[1]):
+        print("bench_gate: no baseline; skipping regression check")
+        return 0
+
+    baseline = load_baseline(sys.argv[1])
+    regressions = []
+    for bench_id, median_ns in sorted(results.items()):
+        previous = baseline.get(bench_id)
+        if previous is None:
+            continue
+        ratio = median_ns / previous
+        marker = "REGRESSION" if ratio > THRESHOLD else "ok"
+        print(f"bench_gate: {bench_id}: {previous:.1f} -> {median_ns:.1f} ns ({ratio:.3f}x) {marker}")
+        if ratio > THRESHOLD:
+            regressions.append(bench_id)
+
+    if regressions:
+        print(f"bench_gate: {len(regressions)} regression(s) over {THRESHOLD:.0%}:", file=sys.stderr)
+        for bench_id in regressions:
+            print(f"  {bench_id}", file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,48 @@
+/* libwc — stable C API for the wc-rs counting kernels.
+ *
+ * Counts lines, words, bytes, UTF-8 characters, and maximum display width
+ * over caller-owned buffers with zero copies and zero allocations (the
+ * stream handle is the single exception). Thread-safe: distinct streams may
+ * be used from distinct threads concurrently.
+ */
+
+#ifndef WC_H
+#define WC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WC_OK 0
+#define WC_ERR_NULL (-1)
+
+typedef struct {
+    uint64_t lines;
+    uint64_t words;
+    uint64_t bytes;
+    uint64_t chars;
+    uint64_t max_line_length;
+} WcCounts;
+
+/* Opaque streaming state. */
+typedef struct WcStream WcStream;
+
+/* One-shot: counts len bytes at ptr into *out. ptr may be NULL only when
+ * len is 0. Returns WC_OK or WC_ERR_NULL. */
+int wc_count_buffer(const uint8_t *ptr, size_t len, WcCounts *out);
+
+/* Streaming: feed chunks in order, snapshot at any point, keep feeding.
+ * wc_stream_counts does not consume the state. */
+WcStream *wc_stream_new(void);
+int wc_stream_feed(WcStream *stream, const uint8_t *ptr, size_t len);
+int wc_stream_counts(const WcStream *stream, WcCounts *out);
+void wc_stream_free(WcStream *stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WC_H */
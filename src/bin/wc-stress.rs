@@ -0,0 +1,163 @@
+//! Stress and baseline harness (`cargo run --release --bin wc-stress`).
+//!
+//! Complements the torture tests with the runs that are too expensive for
+//! `cargo test`: multi-hundred-MB synthetic streams, engine parity on
+//! them, and per-platform throughput baselines recorded to
+//! `test_output.txt`. It fails loudly when a platform falls off a cliff —
+//! a vector kernel silently degrading to the scalar fallback (e.g. NEON
+//! missing on an aarch64 build) or throughput dropping below a floor no
+//! healthy host should miss — so a bad build dies in CI instead of
+//! shipping slow.
+
+use std::fs::File;
+use std::time::Instant;
+
+use wc::counts::{Counter, Counts, Selection};
+use wc::input::{self, IoOptions, BUF_SIZE};
+use wc::kernel;
+
+/// Synthetic corpus size: large enough that per-call overheads vanish.
+const CORPUS: usize = 256 * 1024 * 1024;
+/// No healthy CI host counts newlines below this (GB/s).
+const NEWLINE_FLOOR_GBPS: f64 = 0.5;
+
+fn selection() -> Selection {
+    Selection {
+        lines: true,
+        words: true,
+        bytes: true,
+        chars: true,
+        max_line_length: false,
+    }
+}
+
+fn corpus() -> Vec<u8> {
+    // Mixed shape: ASCII log lines, UTF-8 runs, neutral bytes, and words
+    // planted across buffer boundaries.
+    let mut data = Vec::with_capacity(CORPUS);
+    let blocks: [&[u8]; 4] = [
+        b"10.0.0.1 - - GET /api/x 200 17ms\n",
+        "ünïcode 日本語 mixed content\n".as_bytes(),
+        b"\x01\x02 neutral\x01bytes here\n",
+        b"a\nb\nc\nd\ne\nf\ng\nh\n",
+    ];
+    let mut i = 0;
+    while data.len() < CORPUS {
+        data.extend_from_slice(blocks[i % blocks.len()]);
+        i += 1;
+    }
+    data.truncate(CORPUS);
+    data
+}
+
+fn time_kernel(name: &str, data: &[u8], f: impl Fn(&[u8]) -> u64) -> (String, f64) {
+    // Two passes: the first warms, the second measures.
+    let mut result = 0;
+    let mut best = f64::MAX;
+    for _ in 0..2 {
+        let start = Instant::now();
+        result = f(data);
+        best = best.min(start.elapsed().as_secs_f64());
+    }
+    let rate = data.len() as f64 / 1e9 / best;
+    (
+        format!("{name}_gbps={rate:.2} {name}_result={result}"),
+        rate,
+    )
+}
+
+fn main() {
+    let mut failures: Vec<String> = Vec::new();
+    let mut report: Vec<String> = Vec::new();
+    let platform = format!("{}-{}", std::env::consts::OS, std::env::consts::ARCH);
+    report.push(format!("platform={platform}"));
+    report.push(format!("kernel={}", kernel::kernel_name()));
+
+    // Cliff check 1: the dispatcher must have found a vector kernel on the
+    // architectures that always have one.
+    #[cfg(target_arch = "aarch64")]
+    if kernel::kernel_name() != "neon" {
+        failures.push(format!(
+            "aarch64 build dispatched '{}' instead of neon",
+            kernel::kernel_name()
+        ));
+    }
+    #[cfg(target_arch = "x86_64")]
+    if kernel::kernel_name() == "swar" && is_x86_feature_detected!("avx2") {
+        failures.push("x86_64 host has avx2 but dispatch chose swar".into());
+    }
+
+    let data = corpus();
+
+    // Throughput baselines for the hot kernels.
+    let (line, newline_rate) = time_kernel("newlines", &data, |d| kernel::count_byte(d, b'\n'));
+    report.push(line);
+    let (line, _) = time_kernel("words", &data, |d| wc::word::count_words(d, false).0);
+    report.push(line);
+    let (line, _) = time_kernel("chars", &data, kernel::count_utf8_chars);
+    report.push(line);
+    if newline_rate < NEWLINE_FLOOR_GBPS {
+        failures.push(format!(
+            "newline kernel at {newline_rate:.2} GB/s, below the {NEWLINE_FLOOR_GBPS} GB/s floor"
+        ));
+    }
+
+    // Engine parity on the synthetic corpus, via a real file.
+    let expected = {
+        let mut counter = Counter::new(selection());
+        counter.feed(&data);
+        counter.finish()
+    };
+    let path = std::env::temp_dir().join(format!("wc-stress-{}", std::process::id()));
+    std::fs::write(&path, &data).expect("write stress corpus");
+    let mut buf = vec![0u8; BUF_SIZE];
+    let mut check = |name: &str, counts: Counts| {
+        if counts == expected {
+            report.push(format!("parity_{name}=ok"));
+        } else {
+            failures.push(format!(
+                "engine {name} disagrees: {counts:?} != {expected:?}"
+            ));
+        }
+    };
+    let streamed = input::count_reader(&mut File::open(&path).unwrap(), selection(), &mut buf)
+        .expect("stream count");
+    check("stream", streamed);
+    for threads in [1, 8] {
+        let opts = IoOptions {
+            threads,
+            ..Default::default()
+        };
+        let counts =
+            input::count_file(&mut File::open(&path).unwrap(), selection(), opts, &mut buf)
+                .expect("file count");
+        check(&format!("threads{threads}"), counts);
+    }
+    #[cfg(all(target_os = "linux", feature = "io_uring"))]
+    {
+        let file = File::open(&path).unwrap();
+        let len = file.metadata().unwrap().len();
+        match wc::uring::try_count_file(&file, len, selection()).expect("uring count") {
+            Some(counts) => check("uring", counts),
+            None => report.push("parity_uring=unavailable".into()),
+        }
+    }
+    std::fs::remove_file(&path).ok();
+
+    report.push(format!(
+        "status={}",
+        if failures.is_empty() { "ok" } else { "failed" }
+    ));
+    let line = report.join(" ");
+    println!("{line}");
+    if let Err(e) = std::fs::write("test_output.txt", format!("{line}\n")) {
+        eprintln!("wc-stress: cannot write test_output.txt: {e}");
+    }
+
+    if !failures.is_empty() {
+        for failure in &failures {
+            eprintln!("wc-stress: FAIL: {failure}");
+        }
+        std::process::exit(1);
+    }
+}
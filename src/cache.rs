@@ -0,0 +1,307 @@
+//! Incremental recount cache (`--cache <path>`).
+//!
+//! Recounting the same tree every few minutes re-reads files that almost
+//! never change. The cache persists per-file counts in a compact binary
+//! index keyed by (device, inode) and validated by (mtime, mtime_nsec,
+//! size): a later run re-reads only files whose metadata moved and serves
+//! the rest from the index. Each entry records which counters it actually
+//! holds, so a run with different flags misses cleanly and widens the
+//! entry.
+//!
+//! Everything fails safe to a full recount: unreadable file, wrong magic,
+//! wrong version, or a truncated entry table all load as an empty cache,
+//! and saving writes a temp file then renames so a crash never leaves a
+//! half-written index behind.
+
+use std::collections::HashMap;
+use std::fs;
+use std::io::{self, Write};
+use std::os::unix::fs::MetadataExt;
+use std::path::{Path, PathBuf};
+
+use crate::counts::{Counts, Selection};
+
+const MAGIC: &[u8; 8] = b"WCRSCACH";
+const VERSION: u32 = 2;
+/// magic + version + delimiter fingerprint + entry count.
+const HEADER_SIZE: usize = 8 + 4 + 8 + 4;
+/// dev + ino + mtime + mtime_nsec + size + mask (+3 pad) + 5 counters.
+const ENTRY_SIZE: usize = 8 + 8 + 8 + 4 + 8 + 4 + 5 * 8;
+
+#[derive(Clone, Copy)]
+struct Entry {
+    mtime: i64,
+    mtime_nsec: u32,
+    size: u64,
+    mask: u8,
+    counts: Counts,
+}
+
+pub struct Cache {
+    path: PathBuf,
+    entries: HashMap<(u64, u64), Entry>,
+    dirty: bool,
+}
+
+impl Cache {
+    /// Loads the index at `path`. Any problem — missing file, bad magic,
+    /// version mismatch, truncation, or a delimiter configuration other
+    /// than the one the index was written under — yields an empty cache so
+    /// the run degrades to a full recount rather than trusting bad data.
+    pub fn load(path: &Path) -> Cache {
+        let entries = fs::read(path)
+            .ok()
+            .and_then(|data| parse(&data))
+            .unwrap_or_default();
+        Cache {
+            path: path.to_owned(),
+            entries,
+            dirty: false,
+        }
+    }
+
+    /// Returns cached counts when the file's identity and metadata match
+    /// and the entry covers every requested counter.
+    pub fn lookup(&self, meta: &fs::Metadata, selection: Selection) -> Option<Counts> {
+        let entry = self.entries.get(&(meta.dev(), meta.ino()))?;
+        if entry.mtime != meta.mtime()
+            || entry.mtime_nsec != meta.mtime_nsec() as u32
+            || entry.size != meta.size()
+        {
+            return None;
+        }
+        let wanted = selection.mask();
+        if entry.mask & wanted != wanted {
+            return None;
+        }
+        let mut counts = entry.counts;
+        if !selection.lines {
+            counts.lines = 0;
+        }
+        if !selection.words {
+            counts.words = 0;
+        }
+        if !selection.bytes {
+            counts.bytes = 0;
+        }
+        if !selection.chars {
+            counts.chars = 0;
+        }
+        if !selection.max_line_length {
+            counts.max_line_length = 0;
+        }
+        Some(counts)
+    }
+
+    /// Records freshly computed counts. An existing entry for the same
+    /// unchanged file is widened rather than replaced, so alternating flag
+    /// sets converge on a full entry.
+    pub fn update(&mut self, meta: &fs::Metadata, selection: Selection, counts: &Counts) {
+        let key = (meta.dev(), meta.ino());
+        let mask = selection.mask();
+        let fresh = Entry {
+            mtime: meta.mtime(),
+            mtime_nsec: meta.mtime_nsec() as u32,
+            size: meta.size(),
+            mask,
+            counts: *counts,
+        };
+        let entry = self.entries.entry(key).or_insert(fresh);
+        if entry.mtime == fresh.mtime
+            && entry.mtime_nsec == fresh.mtime_nsec
+            && entry.size == fresh.size
+        {
+            if selection.lines {
+                entry.counts.lines = counts.lines;
+            }
+            if selection.words {
+                entry.counts.words = counts.words;
+            }
+            if selection.bytes {
+                entry.counts.bytes = counts.bytes;
+            }
+            if selection.chars {
+                entry.counts.chars = counts.chars;
+            }
+            if selection.max_line_length {
+                entry.counts.max_line_length = counts.max_line_length;
+            }
+            entry.mask |= mask;
+        } else {
+            *entry = fresh;
+        }
+        self.dirty = true;
+    }
+
+    /// Persists the index atomically (temp file + rename). A clean cache is
+    /// left untouched.
+    pub fn save(&self) -> io::Result<()> {
+        if !self.dirty {
+            return Ok(());
+        }
+        let mut data = Vec::with_capacity(HEADER_SIZE + self.entries.len() * ENTRY_SIZE);
+        data.extend_from_slice(MAGIC);
+        data.extend_from_slice(&VERSION.to_le_bytes());
+        data.extend_from_slice(&crate::counts::delims_fingerprint().to_le_bytes());
+        data.extend_from_slice(&(self.entries.len() as u32).to_le_bytes());
+        for ((dev, ino), entry) in &self.entries {
+            data.extend_from_slice(&dev.to_le_bytes());
+            data.extend_from_slice(&ino.to_le_bytes());
+            data.extend_from_slice(&entry.mtime.to_le_bytes());
+            data.extend_from_slice(&entry.mtime_nsec.to_le_bytes());
+            data.extend_from_slice(&entry.size.to_le_bytes());
+            data.extend_from_slice(&(entry.mask as u32).to_le_bytes());
+            for value in [
+                entry.counts.lines,
+                entry.counts.words,
+                entry.counts.bytes,
+                entry.counts.chars,
+                entry.counts.max_line_length,
+            ] {
+                data.extend_from_slice(&value.to_le_bytes());
+            }
+        }
+        let tmp = self.path.with_extension("tmp");
+        let mut file = fs::File::create(&tmp)?;
+        file.write_all(&data)?;
+        file.sync_all()?;
+        fs::rename(&tmp, &self.path)
+    }
+}
+
+fn parse(data: &[u8]) -> Option<HashMap<(u64, u64), Entry>> {
+    if data.len() < HEADER_SIZE || &data[..8] != MAGIC {
+        return None;
+    }
+    let version = u32::from_le_bytes(data[8..12].try_into().unwrap());
+    if version != VERSION {
+        return None;
+    }
+    let fingerprint = u64::from_le_bytes(data[12..20].try_into().unwrap());
+    if fingerprint != crate::counts::delims_fingerprint() {
+        // Counts depend on the delimiter set; entries written under a
+        // different --line-delim/--word-delims must not be served.
+        return None;
+    }
+    let count = u32::from_le_bytes(data[20..24].try_into().unwrap()) as usize;
+    let body = &data[HEADER_SIZE..];
+    if body.len() != count * ENTRY_SIZE {
+        return None;
+    }
+    let mut entries = HashMap::with_capacity(count);
+    for chunk in body.chunks_exact(ENTRY_SIZE) {
+        let u64_at = |off: usize| u64::from_le_bytes(chunk[off..off + 8].try_into().unwrap());
+        let dev = u64_at(0);
+        let ino = u64_at(8);
+        let mtime = u64_at(16) as i64;
+        let mtime_nsec = u32::from_le_bytes(chunk[24..28].try_into().unwrap());
+        let size = u64_at(28);
+        let mask = u32::from_le_bytes(chunk[36..40].try_into().unwrap()) as u8;
+        entries.insert(
+            (dev, ino),
+            Entry {
+                mtime,
+                mtime_nsec,
+                size,
+                mask,
+                counts: Counts {
+                    lines: u64_at(40),
+                    words: u64_at(48),
+                    bytes: u64_at(56),
+                    chars: u64_at(64),
+                    max_line_length: u64_at(72),
+                },
+            },
+        );
+    }
+    Some(entries)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn temp_path(name: &str) -> PathBuf {
+        std::env::temp_dir().join(format!("wc-rs-cache-{}-{name}", std::process::id()))
+    }
+
+    fn counts(lines: u64) -> Counts {
+        Counts {
+            lines,
+            words: lines * 2,
+            bytes: lines * 10,
+            chars: lines * 10,
+            max_line_length: 9,
+        }
+    }
+
+    #[test]
+    fn roundtrip_hit_and_stale_miss() {
+        let data_path = temp_path("data");
+        let index_path = temp_path("index");
+        fs::write(&data_path, b"one\ntwo\n").unwrap();
+        let meta = fs::metadata(&data_path).unwrap();
+        let selection = Selection::default_counters();
+
+        let mut cache = Cache::load(&index_path);
+        assert!(cache.lookup(&meta, selection).is_none());
+        cache.update(&meta, selection, &counts(2));
+        cache.save().unwrap();
+
+        let cache = Cache::load(&index_path);
+        assert_eq!(cache.lookup(&meta, selection).unwrap().lines, 2);
+
+        // Same inode, changed content: metadata no longer matches.
+        std::thread::sleep(std::time::Duration::from_millis(10));
+        fs::write(&data_path, b"one\ntwo\nthree!\n").unwrap();
+        let newer = fs::metadata(&data_path).unwrap();
+        assert!(cache.lookup(&newer, selection).is_none());
+
+        fs::remove_file(&data_path).unwrap();
+        fs::remove_file(&index_path).unwrap();
+    }
+
+    #[test]
+    fn narrower_entry_misses_then_widens() {
+        let data_path = temp_path("widen-data");
+        let index_path = temp_path("widen-index");
+        fs::write(&data_path, b"x y\n").unwrap();
+        let meta = fs::metadata(&data_path).unwrap();
+        let lines_only = Selection {
+            lines: true,
+            ..Selection::default()
+        };
+        let words_only = Selection {
+            words: true,
+            ..Selection::default()
+        };
+
+        let mut cache = Cache::load(&index_path);
+        cache.update(&meta, lines_only, &counts(1));
+        assert!(cache.lookup(&meta, words_only).is_none());
+        cache.update(&meta, words_only, &counts(1));
+        // Now both are served, each masked to its own selection.
+        assert_eq!(cache.lookup(&meta, lines_only).unwrap().words, 0);
+        assert_eq!(cache.lookup(&meta, words_only).unwrap().words, 2);
+
+        fs::remove_file(&data_path).unwrap();
+    }
+
+    #[test]
+    fn corruption_and_version_mismatch_fail_safe() {
+        let index_path = temp_path("corrupt");
+        fs::write(&index_path, b"WCRSCACHgarbage that is not entries").unwrap();
+        let cache = Cache::load(&index_path);
+        assert!(cache.entries.is_empty());
+
+        let mut bad_version = Vec::new();
+        bad_version.extend_from_slice(MAGIC);
+        bad_version.extend_from_slice(&99u32.to_le_bytes());
+        bad_version.extend_from_slice(&0u32.to_le_bytes());
+        fs::write(&index_path, &bad_version).unwrap();
+        let cache = Cache::load(&index_path);
+        assert!(cache.entries.is_empty());
+
+        fs::remove_file(&index_path).unwrap();
+    }
+}
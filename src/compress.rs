@@ -0,0 +1,141 @@
+//! Transparent decompression for gzip and zstd inputs (`--decompress`).
+//!
+//! `zcat file | wc` costs a process, a pipe copy, and any chance of
+//! overlap. With `--decompress` the input's leading magic bytes pick a
+//! decoder (extension is ignored), and decompressed blocks feed the
+//! counting kernels directly through the overlapped pipeline from the
+//! streaming engine — the decoder runs on the reader thread while the
+//! counters chew on the previous block. Multi-member gzip archives decode
+//! end to end via `MultiGzDecoder`; decoding members in parallel would
+//! need an external member index, which plain `.gz` files do not carry.
+//!
+//! Counts refer to the decompressed content, matching what the zcat
+//! pipeline produced. Inputs without a known magic count as-is.
+
+use std::io::{self, Read};
+
+use crate::counts::{Counts, Selection};
+use crate::stream;
+
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum Kind {
+    Gzip,
+    Zstd,
+}
+
+/// Identifies a compression format from a file's first bytes.
+pub fn sniff(header: &[u8]) -> Option<Kind> {
+    match header {
+        [0x1F, 0x8B, ..] => Some(Kind::Gzip),
+        [0x28, 0xB5, 0x2F, 0xFD, ..] => Some(Kind::Zstd),
+        _ => None,
+    }
+}
+
+/// Counts `reader`, decoding it when its leading bytes carry a known
+/// compression magic; plain input counts unchanged. The consumed header is
+/// chained back in front of the reader so the decoder sees a whole stream.
+pub fn count_maybe_compressed<R: Read + Send>(
+    mut reader: R,
+    selection: Selection,
+) -> io::Result<Counts> {
+    let mut header = [0u8; 4];
+    let mut filled = 0;
+    while filled < header.len() {
+        match reader.read(&mut header[filled..]) {
+            Ok(0) => break,
+            Ok(n) => filled += n,
+            Err(e) if e.kind() == io::ErrorKind::Interrupted => {}
+            Err(e) => return Err(e),
+        }
+    }
+    let prefix = io::Cursor::new(header[..filled].to_vec());
+    let chained = prefix.chain(reader);
+    match sniff(&header[..filled]) {
+        Some(Kind::Gzip) => {
+            let mut decoder = flate2::read::MultiGzDecoder::new(chained);
+            stream::count_reader_overlapped(&mut decoder, selection)
+        }
+        Some(Kind::Zstd) => {
+            let mut decoder = zstd::stream::read::Decoder::new(chained)?;
+            stream::count_reader_overlapped(&mut decoder, selection)
+        }
+        None => {
+            let mut chained = chained;
+            stream::count_reader_overlapped(&mut chained, selection)
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use flate2::write::GzEncoder;
+    use std::io::Write;
+
+    fn all_counters() -> Selection {
+        Selection {
+            lines: true,
+            words: true,
+            bytes: true,
+            chars: true,
+            max_line_length: true,
+        }
+    }
+
+    fn plain_counts(data: &[u8]) -> Counts {
+        let mut counter = crate::counts::Counter::new(all_counters());
+        counter.feed(data);
+        counter.finish()
+    }
+
+    const TEXT: &[u8] = b"compressed words\nand lines here\nthird line\n";
+
+    #[test]
+    fn gzip_counts_decompressed_content() {
+        let mut encoder = GzEncoder::new(Vec::new(), flate2::Compression::default());
+        encoder.write_all(TEXT).unwrap();
+        let gz = encoder.finish().unwrap();
+        let counts = count_maybe_compressed(&gz[..], all_counters()).unwrap();
+        assert_eq!(counts, plain_counts(TEXT));
+    }
+
+    #[test]
+    fn multi_member_gzip_decodes_every_member() {
+        let mut joined = Vec::new();
+        for part in [&TEXT[..20], &TEXT[20..]] {
+            let mut encoder = GzEncoder::new(Vec::new(), flate2::Compression::default());
+            encoder.write_all(part).unwrap();
+            joined.extend_from_slice(&encoder.finish().unwrap());
+        }
+        let counts = count_maybe_compressed(&joined[..], all_counters()).unwrap();
+        assert_eq!(counts, plain_counts(TEXT));
+    }
+
+    #[test]
+    fn zstd_counts_decompressed_content() {
+        let zst = zstd::stream::encode_all(TEXT, 3).unwrap();
+        let counts = count_maybe_compressed(&zst[..], all_counters()).unwrap();
+        assert_eq!(counts, plain_counts(TEXT));
+    }
+
+    #[test]
+    fn plain_input_passes_through() {
+        let counts = count_maybe_compressed(TEXT, all_counters()).unwrap();
+        assert_eq!(counts, plain_counts(TEXT));
+    }
+
+    #[test]
+    fn short_input_passes_through() {
+        let counts = count_maybe_compressed(&b"hi"[..], all_counters()).unwrap();
+        assert_eq!(counts.bytes, 2);
+    }
+
+    #[test]
+    fn truncated_gzip_reports_an_error() {
+        let mut encoder = GzEncoder::new(Vec::new(), flate2::Compression::default());
+        encoder.write_all(TEXT).unwrap();
+        let gz = encoder.finish().unwrap();
+        assert!(count_maybe_compressed(&gz[..gz.len() / 2], all_counters()).is_err());
+    }
+}
@@ -0,0 +1,431 @@
+//! Streaming counters and the result types they produce.
+
+use std::sync::OnceLock;
+
+use crate::kernel;
+use crate::linelen;
+use crate::word;
+
+/// Delimiter configuration for a run. `line` is the byte that terminates a
+/// record (newline unless `--line-delim` overrides it); `word_separators`
+/// is a 256-bit bitmap of separator bytes when `--word-delims` replaces the
+/// whitespace rule, with every other byte a word constituent.
+#[derive(Clone, Copy, Debug)]
+pub struct Delims {
+    pub line: u8,
+    pub word_separators: Option<[u64; 4]>,
+}
+
+impl Default for Delims {
+    fn default() -> Self {
+        Delims {
+            line: b'\n',
+            word_separators: None,
+        }
+    }
+}
+
+static CUSTOM_DELIMS: OnceLock<Delims> = OnceLock::new();
+
+/// Installs process-wide delimiter overrides; call once at startup before
+/// any counting. Later calls are ignored.
+pub fn set_delims(delims: Delims) {
+    let _ = CUSTOM_DELIMS.set(delims);
+}
+
+pub fn delims() -> Delims {
+    CUSTOM_DELIMS.get().copied().unwrap_or_default()
+}
+
+/// True when `--word-delims` replaced the standard whitespace rule; the
+/// parallel engine's boundary stitching assumes the standard classes, so it
+/// steps aside.
+pub fn custom_word_delims_active() -> bool {
+    delims().word_separators.is_some()
+}
+
+/// Stable fingerprint of the effective delimiter configuration. Persistent
+/// stores (the recount cache, the append index) stamp their files with it
+/// so entries written under one delimiter set are never served to runs
+/// using another.
+pub fn delims_fingerprint() -> u64 {
+    let delims = delims();
+    let mut h = 0xcbf2_9ce4_8422_2325u64 ^ delims.line as u64;
+    for word in delims.word_separators.unwrap_or([!0, !0, !0, !0]) {
+        h ^= word;
+        h = h.wrapping_mul(0x0000_0100_0000_01b3);
+    }
+    h
+}
+
+/// Which counters a run was asked to produce.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct Selection {
+    pub lines: bool,
+    pub words: bool,
+    pub bytes: bool,
+    pub chars: bool,
+    pub max_line_length: bool,
+}
+
+impl Selection {
+    /// The default `wc` behaviour when no counter flags are given.
+    pub fn default_counters() -> Self {
+        Selection {
+            lines: true,
+            words: true,
+            bytes: true,
+            ..Selection::default()
+        }
+    }
+
+    pub fn any(&self) -> bool {
+        self.lines || self.words || self.bytes || self.chars || self.max_line_length
+    }
+
+    /// True when only the byte count is wanted, which `fstat` can answer
+    /// for regular files without reading a single byte.
+    pub fn bytes_only(&self) -> bool {
+        self.bytes && !self.lines && !self.words && !self.chars && !self.max_line_length
+    }
+
+    /// Bitmask of the enabled counters; persistent stores (cache, index)
+    /// record it so entries are only served to runs they can satisfy.
+    pub fn mask(&self) -> u8 {
+        self.lines as u8
+            | (self.words as u8) << 1
+            | (self.bytes as u8) << 2
+            | (self.chars as u8) << 3
+            | (self.max_line_length as u8) << 4
+    }
+
+    pub fn count_enabled(&self) -> usize {
+        [
+            self.lines,
+            self.words,
+            self.bytes,
+            self.chars,
+            self.max_line_length,
+        ]
+        .iter()
+        .filter(|&&on| on)
+        .count()
+    }
+}
+
+/// Counts for one input (or the totals line).
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct Counts {
+    pub lines: u64,
+    pub words: u64,
+    pub bytes: u64,
+    pub chars: u64,
+    pub max_line_length: u64,
+}
+
+impl Counts {
+    /// Folds `other` into `self` the way the totals line does.
+    pub fn add(&mut self, other: &Counts) {
+        self.lines += other.lines;
+        self.words += other.words;
+        self.bytes += other.bytes;
+        self.chars += other.chars;
+        self.max_line_length = self.max_line_length.max(other.max_line_length);
+    }
+}
+
+/// Streaming counter: feed it buffers in order, then call `finish`.
+///
+/// Word boundaries use the C-locale `isspace` set, and the character count
+/// treats every non-continuation byte as one character (exact for valid
+/// UTF-8). Both match what GNU `wc` produces in a UTF-8 locale for the
+/// inputs we care about.
+#[derive(Clone, Debug)]
+pub struct Counter {
+    selection: Selection,
+    delims: Delims,
+    counts: Counts,
+    in_word: bool,
+    width: linelen::WidthTracker,
+    /// Monomorphized feed for this flag combination, chosen once at
+    /// construction; the steady-state loop carries no flag branches.
+    feed_fn: FeedFn,
+}
+
+type FeedFn = fn(&mut Counter, &[u8]);
+
+/// The counting passes, generic over a const flag set: the compiler emits
+/// one specialized body per combination actually reachable, with the
+/// disabled passes folded away entirely. `wc -l` runs a loop that knows
+/// only about newlines; `-lw` a fused line+word pair; and so on.
+fn feed_passes<const LINES: bool, const WORDS: bool, const CHARS: bool, const MAXL: bool>(
+    c: &mut Counter,
+    buf: &[u8],
+) {
+    if LINES {
+        c.counts.lines += kernel::count_byte(buf, c.delims.line);
+    }
+    if WORDS {
+        let (words, in_word) = match &c.delims.word_separators {
+            Some(bitmap) => word::count_words_custom(buf, bitmap, c.in_word),
+            None => word::count_words(buf, c.in_word),
+        };
+        c.counts.words += words;
+        c.in_word = in_word;
+    }
+    if CHARS {
+        c.counts.chars += kernel::count_utf8_chars(buf);
+    }
+    if MAXL {
+        c.width.feed(buf, &mut c.counts.max_line_length);
+    }
+}
+
+/// Specializations indexed by `lines | words<<1 | chars<<2 | maxl<<3`.
+static FEED_TABLE: [FeedFn; 16] = [
+    feed_passes::<false, false, false, false>,
+    feed_passes::<true, false, false, false>,
+    feed_passes::<false, true, false, false>,
+    feed_passes::<true, true, false, false>,
+    feed_passes::<false, false, true, false>,
+    feed_passes::<true, false, true, false>,
+    feed_passes::<false, true, true, false>,
+    feed_passes::<true, true, true, false>,
+    feed_passes::<false, false, false, true>,
+    feed_passes::<true, false, false, true>,
+    feed_passes::<false, true, false, true>,
+    feed_passes::<true, true, false, true>,
+    feed_passes::<false, false, true, true>,
+    feed_passes::<true, false, true, true>,
+    feed_passes::<false, true, true, true>,
+    feed_passes::<true, true, true, true>,
+];
+
+fn select_feed(selection: Selection) -> FeedFn {
+    let index = selection.lines as usize
+        | (selection.words as usize) << 1
+        | (selection.chars as usize) << 2
+        | (selection.max_line_length as usize) << 3;
+    FEED_TABLE[index]
+}
+
+#[inline]
+fn is_word_separator(b: u8) -> bool {
+    matches!(b, b' ' | b'\t' | b'\n' | b'\r' | 0x0B | 0x0C)
+}
+
+/// Whether a byte can start a word. Mirrors GNU wc, where non-printable,
+/// non-space bytes neither begin nor end a word; bytes >= 0x80 are treated
+/// as printable since our inputs are UTF-8.
+#[inline]
+fn is_word_constituent(b: u8) -> bool {
+    matches!(b, 0x21..=0x7E) || b >= 0x80
+}
+
+impl Counter {
+    pub fn new(selection: Selection) -> Self {
+        Counter {
+            selection,
+            delims: delims(),
+            counts: Counts::default(),
+            in_word: false,
+            width: linelen::WidthTracker::default(),
+            feed_fn: select_feed(selection),
+        }
+    }
+
+    /// Feeds a buffer through the passes monomorphized for this counter's
+    /// flag set; each pass runs far faster than a fused branchy loop, and
+    /// the data is hot in cache for the later passes.
+    pub fn feed(&mut self, buf: &[u8]) {
+        crate::stats::add_bytes(buf.len() as u64);
+        self.counts.bytes += buf.len() as u64;
+        let feed_fn = self.feed_fn;
+        feed_fn(self, buf);
+    }
+
+    /// Returns the final counts. Fields outside the selection are zeroed so
+    /// results from different engines compare equal regardless of which
+    /// side-effect counters their loops happened to track.
+    pub fn finish(mut self) -> Counts {
+        // A final line without a terminating newline still competes for -L.
+        let final_width = self.width.finish(&mut self.counts.max_line_length);
+        self.counts.max_line_length = self.counts.max_line_length.max(final_width);
+        if !self.selection.lines {
+            self.counts.lines = 0;
+        }
+        if !self.selection.words {
+            self.counts.words = 0;
+        }
+        if !self.selection.bytes {
+            self.counts.bytes = 0;
+        }
+        if !self.selection.chars {
+            self.counts.chars = 0;
+        }
+        if !self.selection.max_line_length {
+            self.counts.max_line_length = 0;
+        }
+        self.counts
+    }
+
+    /// Whether the counter is mid-word after the bytes fed so far. The
+    /// parallel engine uses this to stitch word counts across chunk edges.
+    pub fn ends_in_word(&self) -> bool {
+        self.in_word
+    }
+
+    /// Rebuilds a counter mid-stream from checkpointed state; the append
+    /// index uses this to resume counting at a byte offset. Not meaningful
+    /// for selections with -L, whose width state is not captured.
+    pub fn resume(selection: Selection, counts: Counts, in_word: bool) -> Self {
+        Counter {
+            selection,
+            delims: delims(),
+            counts,
+            in_word,
+            width: linelen::WidthTracker::default(),
+            feed_fn: select_feed(selection),
+        }
+    }
+
+    /// Counts so far, without consuming the counter (checkpointing).
+    pub fn snapshot(&self) -> (Counts, bool) {
+        (self.counts, self.in_word)
+    }
+}
+
+/// How a byte slice interacts with word state carried in from preceding
+/// bytes; computed from its leading bytes only.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum WordBoundary {
+    /// A word starts before any separator: carried-in word state would merge
+    /// that word with the previous chunk's final word.
+    StartsWord,
+    /// A separator appears before any word constituent: carried-in state is
+    /// irrelevant past this chunk's start.
+    StartsSeparator,
+    /// Only neutral bytes (non-printable, non-space): carried-in word state
+    /// passes through unchanged.
+    AllNeutral,
+}
+
+/// Classifies the start of `chunk` for boundary stitching. Scans only until
+/// the first separator or word constituent.
+pub fn word_boundary(chunk: &[u8]) -> WordBoundary {
+    for &b in chunk {
+        if is_word_separator(b) {
+            return WordBoundary::StartsSeparator;
+        }
+        if is_word_constituent(b) {
+            return WordBoundary::StartsWord;
+        }
+    }
+    WordBoundary::AllNeutral
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn count_all(input: &[u8]) -> Counts {
+        let mut counter = Counter::new(Selection {
+            lines: true,
+            words: true,
+            bytes: true,
+            chars: true,
+            max_line_length: true,
+        });
+        counter.feed(input);
+        counter.finish()
+    }
+
+    #[test]
+    fn empty() {
+        assert_eq!(count_all(b""), Counts::default());
+    }
+
+    #[test]
+    fn plain_ascii() {
+        let counts = count_all(b"hello world\nsecond line\n");
+        assert_eq!(counts.lines, 2);
+        assert_eq!(counts.words, 4);
+        assert_eq!(counts.bytes, 24);
+        assert_eq!(counts.chars, 24);
+        assert_eq!(counts.max_line_length, 11);
+    }
+
+    #[test]
+    fn word_split_across_buffers() {
+        let mut counter = Counter::new(Selection::default_counters());
+        counter.feed(b"hel");
+        counter.feed(b"lo world");
+        let counts = counter.finish();
+        assert_eq!(counts.words, 2);
+        assert_eq!(counts.bytes, 11);
+    }
+
+    #[test]
+    fn utf8_chars() {
+        // "héllo\n" is 7 bytes, 6 characters.
+        let counts = count_all("héllo\n".as_bytes());
+        assert_eq!(counts.bytes, 7);
+        assert_eq!(counts.chars, 6);
+        assert_eq!(counts.words, 1);
+    }
+
+    #[test]
+    fn tabs_advance_to_tab_stops() {
+        let counts = count_all(b"a\tb\n");
+        assert_eq!(counts.max_line_length, 9);
+    }
+
+    #[test]
+    fn no_trailing_newline() {
+        let counts = count_all(b"dangling");
+        assert_eq!(counts.lines, 0);
+        assert_eq!(counts.max_line_length, 8);
+    }
+
+    #[test]
+    fn word_dfa_path_matches_fused_loop() {
+        let input = b"mixed \x01content\x01 with\tneutral bytes\nand lines\n";
+        for selection in [
+            Selection {
+                words: true,
+                ..Selection::default()
+            },
+            Selection {
+                lines: true,
+                words: true,
+                bytes: true,
+                ..Selection::default()
+            },
+        ] {
+            let mut counter = Counter::new(selection);
+            counter.feed(&input[..20]);
+            counter.feed(&input[20..]);
+            let via_dfa = counter.finish();
+            let full = count_all(input);
+            assert_eq!(via_dfa.words, full.words);
+            if selection.lines {
+                assert_eq!(via_dfa.lines, full.lines);
+            }
+        }
+    }
+
+    #[test]
+    fn line_only_fast_path_matches_scalar() {
+        let input = b"a b c\nd e\nf\n";
+        let mut fast = Counter::new(Selection {
+            lines: true,
+            bytes: true,
+            ..Selection::default()
+        });
+        fast.feed(input);
+        let fast = fast.finish();
+        let full = count_all(input);
+        assert_eq!(fast.lines, full.lines);
+        assert_eq!(fast.bytes, full.bytes);
+    }
+}
@@ -0,0 +1,343 @@
+//! Persistent daemon mode and its thin client (Unix).
+//!
+//! A CI farm that spawns the binary millions of times a day pays more for
+//! process startup than for counting. `--daemon` keeps one warm process
+//! listening on a Unix socket; `--client` forwards argv to it and relays
+//! the response, the way compiler daemons amortize startup. When no daemon
+//! is listening the client counts locally, so wiring `--client` into
+//! scripts is always safe.
+//!
+//! Protocol, deliberately tiny: the client sends its argument count and
+//! length-prefixed arguments (paths already absolutized client-side, which
+//! replaces fd passing for the by-path workloads the farm runs); the
+//! daemon streams back tagged, length-prefixed frames — 1 for stdout
+//! bytes, 2 for stderr bytes, 3 for the exit code — and closes.
+
+use std::io::{self, Read, Write};
+use std::os::unix::net::{UnixListener, UnixStream};
+use std::path::{Path, PathBuf};
+
+/// Frame tags.
+const TAG_STDOUT: u8 = 1;
+const TAG_STDERR: u8 = 2;
+const TAG_EXIT: u8 = 3;
+
+/// Options the daemon cannot serve: process-wide one-shot state (delimiter
+/// overrides, stats) would leak between requests.
+const UNSERVABLE: &[&str] = &["--stats", "--daemon", "--client"];
+const UNSERVABLE_PREFIXES: &[&str] = &["--line-delim", "--word-delims", "--daemon=", "--client="];
+
+/// Default socket path: per-user, runtime dir when available.
+pub fn default_socket() -> PathBuf {
+    if let Ok(dir) = std::env::var("XDG_RUNTIME_DIR") {
+        return Path::new(&dir).join("wc-rs.sock");
+    }
+    let uid = unsafe { libc::getuid() };
+    std::env::temp_dir().join(format!("wc-rs-{uid}.sock"))
+}
+
+fn write_frame(stream: &mut impl Write, tag: u8, payload: &[u8]) -> io::Result<()> {
+    stream.write_all(&[tag])?;
+    stream.write_all(&(payload.len() as u32).to_le_bytes())?;
+    stream.write_all(payload)
+}
+
+fn read_exact_or_eof(stream: &mut impl Read, buf: &mut [u8]) -> io::Result<bool> {
+    let mut filled = 0;
+    while filled < buf.len() {
+        match stream.read(&mut buf[filled..]) {
+            Ok(0) => return Ok(false),
+            Ok(n) => filled += n,
+            Err(e) if e.kind() == io::ErrorKind::Interrupted => {}
+            Err(e) => return Err(e),
+        }
+    }
+    Ok(true)
+}
+
+/// Protocol ceilings; a request beyond them is malformed, not negotiable.
+/// Truncating instead would answer for a silent prefix of the command and
+/// leave the unread remainder desyncing the stream.
+const MAX_ARGS: u32 = 4096;
+const MAX_ARG_LEN: u32 = 1 << 20;
+
+enum Request {
+    Args(Vec<String>),
+    /// Over-limit request; the payload was not consumed, so the connection
+    /// must be answered with an error and dropped.
+    Oversized(String),
+}
+
+fn read_args(stream: &mut UnixStream) -> io::Result<Option<Request>> {
+    let mut count = [0u8; 4];
+    if !read_exact_or_eof(stream, &mut count)? {
+        return Ok(None);
+    }
+    let count = u32::from_le_bytes(count);
+    if count > MAX_ARGS {
+        return Ok(Some(Request::Oversized(format!(
+            "request has {count} arguments; the protocol limit is {MAX_ARGS}"
+        ))));
+    }
+    let mut args = Vec::with_capacity(count as usize);
+    for _ in 0..count {
+        let mut len = [0u8; 4];
+        if !read_exact_or_eof(stream, &mut len)? {
+            return Ok(None);
+        }
+        let len = u32::from_le_bytes(len);
+        if len > MAX_ARG_LEN {
+            return Ok(Some(Request::Oversized(format!(
+                "request argument of {len} bytes exceeds the {MAX_ARG_LEN}-byte limit"
+            ))));
+        }
+        let mut arg = vec![0u8; len as usize];
+        if !read_exact_or_eof(stream, &mut arg)? {
+            return Ok(None);
+        }
+        args.push(String::from_utf8_lossy(&arg).into_owned());
+    }
+    Ok(Some(Request::Args(args)))
+}
+
+/// Why an invocation would read standard input — which, served remotely,
+/// would be the daemon's stdin and block forever. The client uses this to
+/// count locally instead of forwarding; the daemon uses it as a hard
+/// reject so foreign protocol speakers cannot wedge it either.
+pub fn requires_stdin(args: &[String]) -> Option<&'static str> {
+    let mut operands = 0usize;
+    let mut has_files0 = false;
+    let mut no_more_flags = false;
+    let mut value_of: Option<&str> = None;
+    for arg in args {
+        if let Some(flag) = value_of.take() {
+            if flag == "--files0-from" {
+                if arg == "-" {
+                    return Some("--files0-from=- reads standard input");
+                }
+                has_files0 = true;
+            }
+            continue;
+        }
+        if no_more_flags || !arg.starts_with('-') || arg == "-" {
+            if arg == "-" {
+                return Some("the '-' operand reads standard input");
+            }
+            operands += 1;
+            continue;
+        }
+        if arg == "--" {
+            no_more_flags = true;
+        } else if arg == "--files0-from=-" {
+            return Some("--files0-from=- reads standard input");
+        } else if arg.starts_with("--files0-from=") {
+            has_files0 = true;
+        } else if VALUE_FLAGS.contains(&arg.as_str()) {
+            value_of = Some(VALUE_FLAGS.iter().find(|f| **f == arg.as_str()).unwrap());
+        }
+    }
+    if operands == 0 && !has_files0 {
+        return Some("no file operands; the run would read standard input");
+    }
+    None
+}
+
+fn servable(args: &[String]) -> Result<(), String> {
+    for arg in args {
+        if UNSERVABLE.contains(&arg.as_str())
+            || UNSERVABLE_PREFIXES.iter().any(|p| arg.starts_with(p))
+        {
+            return Err(format!("option '{arg}' is not supported in daemon mode"));
+        }
+    }
+    if let Some(reason) = requires_stdin(args) {
+        return Err(format!("{reason}, which a daemon cannot serve"));
+    }
+    Ok(())
+}
+
+/// Runs the daemon loop: accept, read argv, execute via `handler`, stream
+/// framed output back. One thread per connection.
+pub fn serve(
+    socket: &Path,
+    handler: impl Fn(Vec<String>, &mut dyn Write, &mut dyn Write) -> u8 + Send + Sync,
+) -> io::Result<()> {
+    // A stale socket from a dead daemon blocks bind; remove it only if
+    // nothing is listening.
+    if UnixStream::connect(socket).is_err() {
+        let _ = std::fs::remove_file(socket);
+    }
+    let listener = UnixListener::bind(socket)?;
+    eprintln!("wc-rs: daemon listening on {}", socket.display());
+
+    std::thread::scope(|scope| {
+        for stream in listener.incoming() {
+            let Ok(mut stream) = stream else { continue };
+            let handler = &handler;
+            scope.spawn(move || {
+                let args = match read_args(&mut stream) {
+                    Ok(Some(Request::Args(args))) => args,
+                    Ok(Some(Request::Oversized(msg))) => {
+                        let _ = write_frame(
+                            &mut stream,
+                            TAG_STDERR,
+                            format!("wc-rs: {msg}\n").as_bytes(),
+                        );
+                        let _ = write_frame(&mut stream, TAG_EXIT, &[1]);
+                        return;
+                    }
+                    _ => return,
+                };
+                let code = match servable(&args) {
+                    Ok(()) => {
+                        let mut out_buf = Vec::new();
+                        let mut err_buf = Vec::new();
+                        let code = handler(args, &mut out_buf, &mut err_buf);
+                        let _ = write_frame(&mut stream, TAG_STDOUT, &out_buf);
+                        let _ = write_frame(&mut stream, TAG_STDERR, &err_buf);
+                        code
+                    }
+                    Err(msg) => {
+                        let _ = write_frame(
+                            &mut stream,
+                            TAG_STDERR,
+                            format!("wc-rs: {msg}\n").as_bytes(),
+                        );
+                        1
+                    }
+                };
+                let _ = write_frame(&mut stream, TAG_EXIT, &[code]);
+                let _ = stream.flush();
+            });
+        }
+        Ok(())
+    })
+}
+
+/// Value-taking flags whose argument must not be mistaken for an operand.
+const VALUE_FLAGS: &[&str] = &["--threads", "--cache", "--files0-from"];
+/// Flags whose (separate or =) value is a path the daemon must see
+/// absolute, since it has its own working directory.
+const PATH_FLAGS: &[&str] = &["--cache", "--files0-from"];
+
+/// Rewrites relative path operands (and path-flag values) against the
+/// client's working directory so the daemon resolves them correctly.
+fn absolutize(args: &[String]) -> Vec<String> {
+    let cwd = std::env::current_dir().unwrap_or_else(|_| PathBuf::from("."));
+    let make_abs = |s: &str| {
+        let p = Path::new(s);
+        if p.is_absolute() || s == "-" {
+            s.to_owned()
+        } else {
+            cwd.join(p).to_string_lossy().into_owned()
+        }
+    };
+
+    let mut rewritten = Vec::with_capacity(args.len());
+    let mut no_more_flags = false;
+    let mut next_is_value_of: Option<&str> = None;
+    'args: for arg in args {
+        if let Some(flag) = next_is_value_of.take() {
+            rewritten.push(if PATH_FLAGS.contains(&flag) {
+                make_abs(arg)
+            } else {
+                arg.clone()
+            });
+            continue;
+        }
+        if no_more_flags || !arg.starts_with('-') || arg == "-" {
+            rewritten.push(make_abs(arg));
+            continue;
+        }
+        if arg == "--" {
+            no_more_flags = true;
+        } else if let Some(flag) = VALUE_FLAGS.iter().find(|f| **f == arg.as_str()) {
+            next_is_value_of = Some(flag);
+        } else {
+            for flag in PATH_FLAGS {
+                let prefix = format!("{flag}=");
+                if let Some(value) = arg.strip_prefix(&prefix) {
+                    rewritten.push(format!("{prefix}{}", make_abs(value)));
+                    continue 'args;
+                }
+            }
+        }
+        rewritten.push(arg.clone());
+    }
+    rewritten
+}
+
+/// Sends argv to the daemon and relays its response. Returns the remote
+/// exit code, or an error when no daemon answers (callers fall back to
+/// local execution).
+pub fn request(socket: &Path, args: &[String]) -> io::Result<u8> {
+    let mut stream = UnixStream::connect(socket)?;
+    let args = absolutize(args);
+    stream.write_all(&(args.len() as u32).to_le_bytes())?;
+    for arg in &args {
+        stream.write_all(&(arg.len() as u32).to_le_bytes())?;
+        stream.write_all(arg.as_bytes())?;
+    }
+
+    let stdout = io::stdout();
+    let stderr = io::stderr();
+    let mut out = stdout.lock();
+    let mut err = stderr.lock();
+    loop {
+        let mut tag = [0u8; 1];
+        if !read_exact_or_eof(&mut stream, &mut tag)? {
+            return Err(io::Error::other("daemon closed without exit frame"));
+        }
+        let mut len = [0u8; 4];
+        if !read_exact_or_eof(&mut stream, &mut len)? {
+            return Err(io::Error::other("truncated frame"));
+        }
+        let mut payload = vec![0u8; u32::from_le_bytes(len) as usize];
+        if !read_exact_or_eof(&mut stream, &mut payload)? {
+            return Err(io::Error::other("truncated frame"));
+        }
+        match tag[0] {
+            TAG_STDOUT => out.write_all(&payload)?,
+            TAG_STDERR => err.write_all(&payload)?,
+            TAG_EXIT => return Ok(payload.first().copied().unwrap_or(1)),
+            _ => return Err(io::Error::other("unknown frame tag")),
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn absolutize_rewrites_operands_not_flag_values() {
+        let cwd = std::env::current_dir().unwrap();
+        let args: Vec<String> = ["-l", "--threads", "8", "rel.txt", "/abs.txt", "--cache=idx"]
+            .iter()
+            .map(|s| s.to_string())
+            .collect();
+        let out = absolutize(&args);
+        assert_eq!(out[0], "-l");
+        assert_eq!(out[1], "--threads");
+        assert_eq!(out[2], "8", "thread count must not become a path");
+        assert_eq!(out[3], cwd.join("rel.txt").to_string_lossy());
+        assert_eq!(out[4], "/abs.txt");
+        assert_eq!(
+            out[5],
+            format!("--cache={}", cwd.join("idx").to_string_lossy())
+        );
+    }
+
+    #[test]
+    fn unservable_flags_are_rejected() {
+        let bad = |s: &str| servable(&[s.to_owned()]).is_err();
+        assert!(bad("--stats"));
+        assert!(bad("--line-delim=\\0"));
+        assert!(bad("-"));
+        assert!(servable(&["-l".into()]).is_err(), "implicit stdin");
+        assert!(servable(&["-l".into(), "--files0-from=-".into()]).is_err());
+        assert!(servable(&["-l".into(), "--files0-from".into(), "-".into()]).is_err());
+        assert!(servable(&["-l".into(), "--files0-from=/tmp/list".into()]).is_ok());
+        assert!(servable(&["-l".into(), "/tmp/x".into()]).is_ok());
+    }
+}
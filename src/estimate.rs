@@ -0,0 +1,215 @@
+//! Approximate counting by block sampling (`--estimate`).
+//!
+//! Capacity planning does not need exact words over petabytes; it needs
+//! ±1% in minutes. Large regular files are sampled at random block-aligned
+//! offsets, each block is counted exactly with the normal kernels, and
+//! per-byte densities extrapolate to the whole file with a normal-theory
+//! confidence interval over the block densities. The byte count is always
+//! exact (it comes from fstat). Small files are cheaper to count exactly
+//! than to sample, and callers fall back to the exact engines for them.
+
+use std::fs::File;
+use std::io;
+#[cfg(unix)]
+use std::os::unix::fs::FileExt;
+#[cfg(windows)]
+use std::os::windows::fs::FileExt as WindowsFileExt;
+
+use crate::counts::{Counter, Counts, Selection};
+
+/// Sampled block size; big enough that word-boundary effects at block
+/// edges vanish in the noise.
+const BLOCK: u64 = 256 * 1024;
+/// Sampling floor: below this an exact count is cheaper than the math.
+pub const ESTIMATE_MIN: u64 = 64 * 1024 * 1024;
+/// Bounds on the number of sampled blocks (16 MiB .. 64 MiB of data read).
+const MIN_BLOCKS: usize = 64;
+const MAX_BLOCKS: usize = 256;
+
+/// An extrapolated result: `counts` holds the estimates (bytes exact),
+/// `moe_percent` the half-width of the confidence interval relative to the
+/// estimate, at level `confidence`.
+pub struct Estimate {
+    pub counts: Counts,
+    pub moe_percent: f64,
+    pub confidence: f64,
+    pub sampled_bytes: u64,
+}
+
+/// Normal quantile for the usual confidence levels; anything else snaps to
+/// the nearest of the three.
+fn z_value(confidence: f64) -> f64 {
+    if confidence >= 0.985 {
+        2.576
+    } else if confidence >= 0.925 {
+        1.960
+    } else {
+        1.645
+    }
+}
+
+/// xorshift64*: no crate, no state file — seeded from the clock and pid so
+/// repeated runs sample different offsets.
+struct Rng(u64);
+
+impl Rng {
+    fn new() -> Rng {
+        let nanos = std::time::SystemTime::now()
+            .duration_since(std::time::UNIX_EPOCH)
+            .map(|d| d.as_nanos() as u64)
+            .unwrap_or(0x9E37_79B9_7F4A_7C15);
+        Rng(nanos ^ ((std::process::id() as u64) << 32) | 1)
+    }
+
+    fn next(&mut self) -> u64 {
+        let mut x = self.0;
+        x ^= x >> 12;
+        x ^= x << 25;
+        x ^= x >> 27;
+        self.0 = x;
+        x.wrapping_mul(0x2545_F491_4F6C_DD1D)
+    }
+}
+
+fn read_block(file: &File, offset: u64, buf: &mut [u8]) -> io::Result<usize> {
+    let mut filled = 0;
+    while filled < buf.len() {
+        #[cfg(unix)]
+        let r = file.read_at(&mut buf[filled..], offset + filled as u64);
+        #[cfg(windows)]
+        let r = file.seek_read(&mut buf[filled..], offset + filled as u64);
+        match r {
+            Ok(0) => break,
+            Ok(n) => filled += n,
+            Err(e) if e.kind() == io::ErrorKind::Interrupted => {}
+            Err(e) => return Err(e),
+        }
+    }
+    Ok(filled)
+}
+
+/// Samples `file` and extrapolates the selected counters.
+pub fn estimate_file(
+    file: &File,
+    len: u64,
+    selection: Selection,
+    confidence: f64,
+) -> io::Result<Estimate> {
+    let total_blocks = len.div_ceil(BLOCK);
+    let samples = (total_blocks / 50)
+        .clamp(MIN_BLOCKS as u64, MAX_BLOCKS as u64)
+        .min(total_blocks) as usize;
+
+    let mut rng = Rng::new();
+    let mut buf = vec![0u8; BLOCK as usize];
+    // Per-block line densities drive the interval; lines and words track
+    // each other closely enough that one interval honestly describes both.
+    let mut line_densities = Vec::with_capacity(samples);
+    let mut sampled = Counts::default();
+    let mut sampled_bytes = 0u64;
+
+    for _ in 0..samples {
+        let block_index = rng.next() % total_blocks;
+        let offset = block_index * BLOCK;
+        let n = read_block(file, offset, &mut buf)?;
+        if n == 0 {
+            continue;
+        }
+        let mut counter = Counter::new(selection);
+        counter.feed(&buf[..n]);
+        let counts = counter.finish();
+        sampled.lines += counts.lines;
+        sampled.words += counts.words;
+        sampled.chars += counts.chars;
+        sampled_bytes += n as u64;
+        line_densities.push(if selection.lines {
+            counts.lines as f64 / n as f64
+        } else if selection.words {
+            counts.words as f64 / n as f64
+        } else {
+            counts.chars as f64 / n as f64
+        });
+    }
+
+    let scale = if sampled_bytes > 0 {
+        len as f64 / sampled_bytes as f64
+    } else {
+        0.0
+    };
+    let counts = Counts {
+        lines: (sampled.lines as f64 * scale).round() as u64,
+        words: (sampled.words as f64 * scale).round() as u64,
+        bytes: len,
+        chars: (sampled.chars as f64 * scale).round() as u64,
+        max_line_length: 0,
+    };
+
+    let n = line_densities.len().max(1) as f64;
+    let mean = line_densities.iter().sum::<f64>() / n;
+    let variance = line_densities
+        .iter()
+        .map(|d| (d - mean) * (d - mean))
+        .sum::<f64>()
+        / (n - 1.0).max(1.0);
+    let moe_percent = if mean > 0.0 {
+        100.0 * z_value(confidence) * (variance / n).sqrt() / mean
+    } else {
+        0.0
+    };
+
+    Ok(Estimate {
+        counts,
+        moe_percent,
+        confidence,
+        sampled_bytes,
+    })
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::io::Write;
+
+    #[test]
+    fn uniform_file_estimates_within_interval() {
+        // 80 MiB of identical lines: density is constant, so the estimate
+        // must land essentially exactly and the interval must be tight.
+        let line = b"exactly forty bytes of sample content!!\n";
+        let repeats = (80 * 1024 * 1024) / line.len();
+        let path = std::env::temp_dir().join(format!("wc-rs-est-{}", std::process::id()));
+        let mut file = File::create(&path).unwrap();
+        let chunk = line.repeat(16384);
+        let mut written = 0;
+        while written < repeats * line.len() {
+            file.write_all(&chunk).unwrap();
+            written += chunk.len();
+        }
+        let file = File::open(&path).unwrap();
+        let len = file.metadata().unwrap().len();
+        let truth = len / line.len() as u64;
+
+        let selection = Selection::default_counters();
+        let est = estimate_file(&file, len, selection, 0.95).unwrap();
+        let err = (est.counts.lines as f64 - truth as f64).abs() / truth as f64;
+        assert!(
+            err < 0.01,
+            "estimate off by {:.3}% (truth {truth}, est {})",
+            err * 100.0,
+            est.counts.lines
+        );
+        assert!(
+            est.moe_percent < 1.0,
+            "uniform data should give a tight interval"
+        );
+        assert_eq!(est.counts.bytes, len);
+        assert!(est.sampled_bytes < len / 4, "must read a bounded fraction");
+        std::fs::remove_file(&path).unwrap();
+    }
+
+    #[test]
+    fn z_values_snap_to_levels() {
+        assert_eq!(z_value(0.90), 1.645);
+        assert_eq!(z_value(0.95), 1.960);
+        assert_eq!(z_value(0.99), 2.576);
+    }
+}
@@ -0,0 +1,196 @@
+//! Stable C ABI for embedding the counters (`libwc`).
+//!
+//! Callers that ingest documents at high rate embed this instead of
+//! fork/exec'ing the binary. The buffer entry point counts a caller-owned
+//! `(ptr, len)` region in place — zero copies, zero allocations. The stream
+//! API carries counter state across chunks for callers that feed input
+//! incrementally; the only allocation is the opaque handle itself.
+//!
+//! The C declarations live in `include/wc.h`. All functions return 0 on
+//! success and a negative `WC_ERR_*` code on misuse; none of them unwind
+//! across the FFI boundary (the counting paths are branch-and-arithmetic
+//! only and cannot panic).
+
+use std::os::raw::c_int;
+
+use crate::counts::{Counter, Counts, Selection};
+
+/// Counts reported through the C ABI. Field order is part of the ABI;
+/// append, never reorder.
+#[repr(C)]
+#[derive(Clone, Copy, Default)]
+pub struct WcCounts {
+    pub lines: u64,
+    pub words: u64,
+    pub bytes: u64,
+    pub chars: u64,
+    pub max_line_length: u64,
+}
+
+/// Opaque streaming state; create with `wc_stream_new`, destroy with
+/// `wc_stream_free`.
+pub struct WcStream {
+    counter: Counter,
+}
+
+pub const WC_OK: c_int = 0;
+pub const WC_ERR_NULL: c_int = -1;
+
+fn everything() -> Selection {
+    Selection {
+        lines: true,
+        words: true,
+        bytes: true,
+        chars: true,
+        max_line_length: true,
+    }
+}
+
+fn to_ffi(counts: Counts) -> WcCounts {
+    WcCounts {
+        lines: counts.lines,
+        words: counts.words,
+        bytes: counts.bytes,
+        chars: counts.chars,
+        max_line_length: counts.max_line_length,
+    }
+}
+
+/// Counts `len` bytes at `ptr` into `*out`. `ptr` may be null only when
+/// `len` is zero.
+///
+/// # Safety
+/// `ptr` must be valid for reading `len` bytes and `out` must be valid for
+/// writing for the duration of the call.
+#[no_mangle]
+pub unsafe extern "C" fn wc_count_buffer(ptr: *const u8, len: usize, out: *mut WcCounts) -> c_int {
+    if out.is_null() || (ptr.is_null() && len != 0) {
+        return WC_ERR_NULL;
+    }
+    let data = if len == 0 {
+        &[]
+    } else {
+        std::slice::from_raw_parts(ptr, len)
+    };
+    let mut counter = Counter::new(everything());
+    counter.feed(data);
+    *out = to_ffi(counter.finish());
+    WC_OK
+}
+
+/// Allocates fresh streaming state. Returns null only on allocation
+/// failure.
+#[no_mangle]
+pub extern "C" fn wc_stream_new() -> *mut WcStream {
+    Box::into_raw(Box::new(WcStream {
+        counter: Counter::new(everything()),
+    }))
+}
+
+/// Feeds the next chunk into the stream.
+///
+/// # Safety
+/// `stream` must come from `wc_stream_new` and not yet be freed; `ptr` must
+/// be valid for reading `len` bytes.
+#[no_mangle]
+pub unsafe extern "C" fn wc_stream_feed(
+    stream: *mut WcStream,
+    ptr: *const u8,
+    len: usize,
+) -> c_int {
+    if stream.is_null() || (ptr.is_null() && len != 0) {
+        return WC_ERR_NULL;
+    }
+    if len != 0 {
+        (*stream).counter.feed(std::slice::from_raw_parts(ptr, len));
+    }
+    WC_OK
+}
+
+/// Writes a snapshot of the counts so far into `*out` without consuming the
+/// stream; feeding may continue afterwards (this is what makes the state
+/// resumable across chunk boundaries).
+///
+/// # Safety
+/// `stream` must come from `wc_stream_new` and not yet be freed; `out` must
+/// be valid for writing.
+#[no_mangle]
+pub unsafe extern "C" fn wc_stream_counts(stream: *const WcStream, out: *mut WcCounts) -> c_int {
+    if stream.is_null() || out.is_null() {
+        return WC_ERR_NULL;
+    }
+    *out = to_ffi((*stream).counter.clone().finish());
+    WC_OK
+}
+
+/// Frees streaming state. Null is a no-op.
+///
+/// # Safety
+/// `stream` must come from `wc_stream_new` and must not be used afterwards.
+#[no_mangle]
+pub unsafe extern "C" fn wc_stream_free(stream: *mut WcStream) {
+    if !stream.is_null() {
+        drop(Box::from_raw(stream));
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn buffer_counts_match_counter() {
+        let data = b"two lines of\nplain text here\n";
+        let mut out = WcCounts::default();
+        let rc = unsafe { wc_count_buffer(data.as_ptr(), data.len(), &mut out) };
+        assert_eq!(rc, WC_OK);
+        assert_eq!(out.lines, 2);
+        assert_eq!(out.words, 6);
+        assert_eq!(out.bytes, data.len() as u64);
+        assert_eq!(out.chars, data.len() as u64);
+        assert_eq!(out.max_line_length, 15);
+    }
+
+    #[test]
+    fn null_arguments_are_rejected() {
+        let mut out = WcCounts::default();
+        unsafe {
+            assert_eq!(wc_count_buffer(std::ptr::null(), 4, &mut out), WC_ERR_NULL);
+            assert_eq!(
+                wc_count_buffer(b"x".as_ptr(), 1, std::ptr::null_mut()),
+                WC_ERR_NULL
+            );
+            assert_eq!(wc_count_buffer(std::ptr::null(), 0, &mut out), WC_OK);
+            assert_eq!(
+                wc_stream_feed(std::ptr::null_mut(), b"x".as_ptr(), 1),
+                WC_ERR_NULL
+            );
+            assert_eq!(wc_stream_counts(std::ptr::null(), &mut out), WC_ERR_NULL);
+            wc_stream_free(std::ptr::null_mut());
+        }
+    }
+
+    #[test]
+    fn stream_resumes_across_chunks() {
+        let stream = wc_stream_new();
+        let mut out = WcCounts::default();
+        unsafe {
+            // Split mid-word and mid-UTF-8-sequence: state must carry.
+            let data = "héllo wörld\nsecond line\n".as_bytes();
+            for chunk in data.chunks(3) {
+                assert_eq!(wc_stream_feed(stream, chunk.as_ptr(), chunk.len()), WC_OK);
+            }
+            assert_eq!(wc_stream_counts(stream, &mut out), WC_OK);
+            assert_eq!(out.lines, 2);
+            assert_eq!(out.words, 4);
+            assert_eq!(out.chars, data.len() as u64 - 2);
+
+            // Snapshot, then keep feeding: counts keep accumulating.
+            assert_eq!(wc_stream_feed(stream, b"more\n".as_ptr(), 5), WC_OK);
+            assert_eq!(wc_stream_counts(stream, &mut out), WC_OK);
+            assert_eq!(out.lines, 3);
+            assert_eq!(out.words, 5);
+            wc_stream_free(stream);
+        }
+    }
+}
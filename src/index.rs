@@ -0,0 +1,318 @@
+//! Count-index sidecars for append-only logs (`--index`).
+//!
+//! A log that only ever grows should not be recounted from byte zero. With
+//! `--index`, counting a file writes a `<file>.wcidx` sidecar recording
+//! counter state (counts plus word-carry) at periodic byte offsets, each
+//! checkpoint tagged with a hash of the 64 KiB window ending at its
+//! offset. The next run picks the newest checkpoint that still fits the
+//! file, re-hashes its window to verify the prefix cheaply, and resumes
+//! counting from there — a 100 GB log that grew by 200 MB becomes a
+//! 200 MB scan. Any mismatch (truncation, rewrite, foreign sidecar
+//! version) falls back to a full recount and a fresh sidecar.
+//!
+//! Selections including `-L` are not indexed: display-width state is not
+//! checkpointed, and max-line-length cannot be resumed soundly.
+
+use std::fs::File;
+use std::io;
+#[cfg(unix)]
+use std::os::unix::fs::FileExt;
+#[cfg(windows)]
+use std::os::windows::fs::FileExt as WindowsFileExt;
+use std::path::{Path, PathBuf};
+
+use crate::counts::{Counter, Counts, Selection};
+use crate::input::BUF_SIZE;
+
+const MAGIC: &[u8; 8] = b"WCRSIDX2";
+/// magic + selection mask (padded) + delimiter fingerprint + entry count.
+const HEADER_SIZE: usize = 8 + 4 + 8 + 4;
+/// Bytes between checkpoints.
+const INTERVAL: u64 = 64 * 1024 * 1024;
+/// Prefix-verification window hashed at each checkpoint.
+const WINDOW: u64 = 64 * 1024;
+/// offset + 5 counters + in_word + window hash, all u64.
+const ENTRY_SIZE: usize = 8 * 8;
+
+#[derive(Clone, Copy)]
+struct Checkpoint {
+    offset: u64,
+    counts: Counts,
+    in_word: bool,
+    window_hash: u64,
+}
+
+/// Sidecar path: the counted file's name with `.wcidx` appended.
+pub fn sidecar_path(path: &Path) -> PathBuf {
+    let mut os = path.as_os_str().to_owned();
+    os.push(".wcidx");
+    PathBuf::from(os)
+}
+
+/// FNV-1a, enough to catch a rewritten prefix; this guards against
+/// operational mistakes, not adversaries.
+fn hash(data: &[u8]) -> u64 {
+    let mut h = 0xcbf2_9ce4_8422_2325u64;
+    for &b in data {
+        h ^= b as u64;
+        h = h.wrapping_mul(0x0000_0100_0000_01b3);
+    }
+    h
+}
+
+fn read_at_exact(file: &File, offset: u64, buf: &mut [u8]) -> io::Result<usize> {
+    let mut filled = 0;
+    while filled < buf.len() {
+        #[cfg(unix)]
+        let r = file.read_at(&mut buf[filled..], offset + filled as u64);
+        #[cfg(windows)]
+        let r = file.seek_read(&mut buf[filled..], offset + filled as u64);
+        match r {
+            Ok(0) => break,
+            Ok(n) => filled += n,
+            Err(e) if e.kind() == io::ErrorKind::Interrupted => {}
+            Err(e) => return Err(e),
+        }
+    }
+    Ok(filled)
+}
+
+fn window_hash(file: &File, offset: u64) -> io::Result<u64> {
+    let start = offset.saturating_sub(WINDOW);
+    let mut buf = vec![0u8; (offset - start) as usize];
+    let n = read_at_exact(file, start, &mut buf)?;
+    Ok(hash(&buf[..n]))
+}
+
+/// Loads checkpoints usable for `selection`: the sidecar must have been
+/// written under the same delimiter configuration, by a run whose counter
+/// set covers every counter requested now — a checkpoint from a plain -l
+/// run holds zeros in its words field, and resuming -w from it would
+/// silently undercount.
+fn load(path: &Path, selection: Selection) -> Vec<Checkpoint> {
+    let Ok(data) = std::fs::read(path) else {
+        return Vec::new();
+    };
+    if data.len() < HEADER_SIZE || &data[..8] != MAGIC {
+        return Vec::new();
+    }
+    let stored_mask = u32::from_le_bytes(data[8..12].try_into().unwrap()) as u8;
+    if stored_mask & selection.mask() != selection.mask() {
+        return Vec::new();
+    }
+    let fingerprint = u64::from_le_bytes(data[12..20].try_into().unwrap());
+    if fingerprint != crate::counts::delims_fingerprint() {
+        return Vec::new();
+    }
+    let count = u32::from_le_bytes(data[20..24].try_into().unwrap()) as usize;
+    let body = &data[HEADER_SIZE..];
+    if body.len() != count * ENTRY_SIZE {
+        return Vec::new();
+    }
+    body.chunks_exact(ENTRY_SIZE)
+        .map(|chunk| {
+            let u64_at = |i: usize| u64::from_le_bytes(chunk[i * 8..i * 8 + 8].try_into().unwrap());
+            Checkpoint {
+                offset: u64_at(0),
+                counts: Counts {
+                    lines: u64_at(1),
+                    words: u64_at(2),
+                    bytes: u64_at(3),
+                    chars: u64_at(4),
+                    max_line_length: 0,
+                },
+                in_word: u64_at(5) != 0,
+                window_hash: u64_at(6),
+            }
+        })
+        .collect()
+}
+
+fn save(path: &Path, selection: Selection, checkpoints: &[Checkpoint]) -> io::Result<()> {
+    let mut data = Vec::with_capacity(HEADER_SIZE + checkpoints.len() * ENTRY_SIZE);
+    data.extend_from_slice(MAGIC);
+    data.extend_from_slice(&(selection.mask() as u32).to_le_bytes());
+    data.extend_from_slice(&crate::counts::delims_fingerprint().to_le_bytes());
+    data.extend_from_slice(&(checkpoints.len() as u32).to_le_bytes());
+    for cp in checkpoints {
+        for value in [
+            cp.offset,
+            cp.counts.lines,
+            cp.counts.words,
+            cp.counts.bytes,
+            cp.counts.chars,
+            cp.in_word as u64,
+            cp.window_hash,
+            0, // reserved
+        ] {
+            data.extend_from_slice(&value.to_le_bytes());
+        }
+    }
+    let tmp = path.with_extension("wcidx.tmp");
+    std::fs::write(&tmp, &data)?;
+    std::fs::rename(&tmp, path)
+}
+
+/// Whether `--index` applies to this selection.
+pub fn supports(selection: Selection) -> bool {
+    !selection.max_line_length
+}
+
+/// Counts `file`, resuming from the sidecar when its newest fitting
+/// checkpoint verifies, and rewrites the sidecar with checkpoints for the
+/// bytes scanned this run.
+pub fn count_file_indexed(
+    path: &Path,
+    file: &File,
+    len: u64,
+    selection: Selection,
+) -> io::Result<Counts> {
+    let sidecar = sidecar_path(path);
+    let old = load(&sidecar, selection);
+
+    // Newest checkpoint that fits the current file and whose window still
+    // hashes the same; anything else means the prefix changed.
+    let mut resume_from: Option<Checkpoint> = None;
+    let mut kept: Vec<Checkpoint> = Vec::new();
+    for cp in old.iter().rev() {
+        if cp.offset <= len && window_hash(file, cp.offset)? == cp.window_hash {
+            resume_from = Some(*cp);
+            kept = old
+                .iter()
+                .copied()
+                .take_while(|c| c.offset <= cp.offset)
+                .collect();
+            break;
+        }
+    }
+
+    let (mut counter, mut offset) = match resume_from {
+        Some(cp) => (Counter::resume(selection, cp.counts, cp.in_word), cp.offset),
+        None => (Counter::new(selection), 0),
+    };
+
+    let mut buf = vec![0u8; BUF_SIZE];
+    let mut next_checkpoint = (offset / INTERVAL + 1) * INTERVAL;
+    let mut checkpoints = kept;
+    while offset < len {
+        let want = buf.len().min((len - offset) as usize);
+        let n = read_at_exact(file, offset, &mut buf[..want])?;
+        if n == 0 {
+            break;
+        }
+        counter.feed(&buf[..n]);
+        offset += n as u64;
+        if offset >= next_checkpoint {
+            let (counts, in_word) = counter.snapshot();
+            checkpoints.push(Checkpoint {
+                offset,
+                counts,
+                in_word,
+                // Hash the window from the file rather than the read buffer:
+                // a short read near the checkpoint would leave the buffer
+                // holding less than the full window.
+                window_hash: window_hash(file, offset)?,
+            });
+            next_checkpoint = (offset / INTERVAL + 1) * INTERVAL;
+        }
+    }
+
+    if let Err(e) = save(&sidecar, selection, &checkpoints) {
+        eprintln!("wc-rs: {}: failed to write index: {e}", path.display());
+    }
+    Ok(counter.finish())
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::io::Write;
+
+    fn selection() -> Selection {
+        Selection::default_counters()
+    }
+
+    fn temp(name: &str) -> PathBuf {
+        std::env::temp_dir().join(format!("wc-rs-idx-{}-{name}", std::process::id()))
+    }
+
+    fn exact(path: &Path) -> Counts {
+        let data = std::fs::read(path).unwrap();
+        let mut counter = Counter::new(selection());
+        counter.feed(&data);
+        counter.finish()
+    }
+
+    #[test]
+    fn append_resumes_from_checkpoint() {
+        let path = temp("append");
+        let mut file = File::create(&path).unwrap();
+        // Big enough for one checkpoint (interval is 64 MiB, so shrink the
+        // test by writing 80 MiB once; subsequent appends are small).
+        let chunk = b"appended log line with words\n".repeat(32768);
+        let mut written = 0u64;
+        while written < 80 * 1024 * 1024 {
+            file.write_all(&chunk).unwrap();
+            written += chunk.len() as u64;
+        }
+        drop(file);
+
+        let f = File::open(&path).unwrap();
+        let len = f.metadata().unwrap().len();
+        let first = count_file_indexed(&path, &f, len, selection()).unwrap();
+        assert_eq!(first, exact(&path));
+        assert!(Path::new(&sidecar_path(&path)).exists());
+
+        // Append a tail that splits a word at the boundary.
+        let mut file = std::fs::OpenOptions::new()
+            .append(true)
+            .open(&path)
+            .unwrap();
+        file.write_all(b"tail words after append\n").unwrap();
+        drop(file);
+        let f = File::open(&path).unwrap();
+        let len = f.metadata().unwrap().len();
+        let second = count_file_indexed(&path, &f, len, selection()).unwrap();
+        assert_eq!(second, exact(&path));
+
+        std::fs::remove_file(&path).unwrap();
+        std::fs::remove_file(sidecar_path(&path)).unwrap();
+    }
+
+    #[test]
+    fn rewritten_prefix_falls_back_to_full_scan() {
+        let path = temp("rewrite");
+        std::fs::write(&path, b"x".repeat(70 * 1024 * 1024)).unwrap();
+        let f = File::open(&path).unwrap();
+        let len = f.metadata().unwrap().len();
+        count_file_indexed(&path, &f, len, selection()).unwrap();
+
+        // Rewrite bytes inside the checkpoint window: hash must mismatch.
+        let data = {
+            let mut d = std::fs::read(&path).unwrap();
+            let at = 64 * 1024 * 1024 - 100;
+            d[at] = b'\n';
+            d
+        };
+        std::fs::write(&path, &data).unwrap();
+        let f = File::open(&path).unwrap();
+        let counts = count_file_indexed(&path, &f, data.len() as u64, selection()).unwrap();
+        assert_eq!(counts, exact(&path));
+        assert_eq!(counts.lines, 1);
+
+        std::fs::remove_file(&path).unwrap();
+        std::fs::remove_file(sidecar_path(&path)).unwrap();
+    }
+
+    #[test]
+    fn garbage_sidecar_is_ignored() {
+        let path = temp("garbage");
+        std::fs::write(&path, b"content\n").unwrap();
+        std::fs::write(sidecar_path(&path), b"not an index at all").unwrap();
+        let f = File::open(&path).unwrap();
+        let counts = count_file_indexed(&path, &f, 8, selection()).unwrap();
+        assert_eq!(counts.lines, 1);
+        std::fs::remove_file(&path).unwrap();
+        std::fs::remove_file(sidecar_path(&path)).unwrap();
+    }
+}
@@ -0,0 +1,401 @@
+//! Input engines: how bytes reach the counting kernels.
+//!
+//! Two strategies exist today. Small files, pipes, and special files stream
+//! through a reusable buffer with `read(2)`. Large regular files are
+//! memory-mapped and counted in place, which skips the kernel-to-userspace
+//! copy entirely — on warm page cache a re-count becomes pure memory
+//! bandwidth instead of double traffic through a bounce buffer.
+
+use std::fs::File;
+use std::io::{self, Read};
+
+use crate::compress;
+use crate::counts::{Counter, Counts, Selection};
+use crate::parallel;
+use crate::stats;
+use crate::stream;
+use crate::utf16;
+
+/// Read-loop buffer size; large enough to amortize syscalls and keep the
+/// vector kernels fed with full blocks.
+pub const BUF_SIZE: usize = 256 * 1024;
+
+/// Files at or above this size are memory-mapped instead of streamed. Below
+/// it the setup cost of `mmap`/`munmap` outweighs the copy it saves.
+pub const MMAP_THRESHOLD: u64 = 1024 * 1024;
+
+/// Engine knobs threaded from the CLI down to the per-file engines.
+#[derive(Clone, Copy, Debug)]
+pub struct IoOptions {
+    /// Worker threads for the parallel single-file engine.
+    pub threads: usize,
+    /// Prefer the io_uring engine for regular files (Linux, opt-in); falls
+    /// back to the portable engines when unavailable.
+    pub uring: bool,
+    /// Sniff magic bytes and decompress gzip/zstd inputs internally.
+    pub decompress: bool,
+    /// Bypass the page cache with O_DIRECT (Linux; --direct).
+    pub direct: bool,
+    /// NUMA-aware thread and buffer placement (Linux; --numa).
+    pub numa: bool,
+    /// Transparent hugepage and staged readahead tuning for the mmap
+    /// engine (Linux; --hugepages).
+    pub hugepages: bool,
+}
+
+impl Default for IoOptions {
+    fn default() -> Self {
+        IoOptions {
+            threads: 1,
+            uring: false,
+            decompress: false,
+            direct: false,
+            numa: false,
+            hugepages: false,
+        }
+    }
+}
+
+/// Counts a stream through `buf` until EOF.
+pub fn count_reader(
+    reader: &mut impl Read,
+    selection: Selection,
+    buf: &mut [u8],
+) -> io::Result<Counts> {
+    let mut counter = Counter::new(selection);
+    loop {
+        stats::add_read_syscall();
+        match stats::timed_io(|| reader.read(buf)) {
+            Ok(0) => break,
+            Ok(n) => stats::timed_count(|| counter.feed(&buf[..n])),
+            Err(e) if e.kind() == io::ErrorKind::Interrupted => continue,
+            Err(e) => return Err(e),
+        }
+    }
+    Ok(counter.finish())
+}
+
+/// Counts an opened file, picking the mmap engine for large regular files
+/// (split across `threads` workers when the file and selection allow it)
+/// and falling back to streaming for everything else (pipes, devices,
+/// procfs files with unreliable sizes, or an mmap that fails outright).
+pub fn count_file(
+    file: &mut File,
+    selection: Selection,
+    opts: IoOptions,
+    buf: &mut [u8],
+) -> io::Result<Counts> {
+    let meta = file.metadata()?;
+    if opts.decompress && meta.is_file() && meta.len() > 0 && sniff_file(file).is_some() {
+        // Decompression changes what the counts refer to, so it outranks
+        // every shortcut, including the -c fstat answer (which would report
+        // the compressed size). Plain files fall through to the usual
+        // engines untouched.
+        stats::bump(stats::Engine::Decompressed);
+        return compress::count_maybe_compressed(file, selection);
+    }
+    if selection.bytes_only() && meta.is_file() && meta.len() > 0 {
+        // -c alone is a metadata question for regular files: answer from
+        // fstat and never read a byte. Size-0 regular files stream instead,
+        // because procfs and sysfs report st_size 0 for non-empty content.
+        stats::bump(stats::Engine::Fstat);
+        return Ok(Counts {
+            bytes: meta.len(),
+            ..Counts::default()
+        });
+    }
+    if !meta.is_file() {
+        // FIFOs and devices block in read(2); overlap the waits with
+        // counting.
+        stats::bump(stats::Engine::Stream);
+        return stream::count_reader_overlapped(file, selection);
+    }
+    // One-shot sequential scans benefit from kernel readahead on every
+    // fd-based engine; the mmap path carries its own madvise.
+    #[cfg(target_os = "linux")]
+    if meta.len() >= MMAP_THRESHOLD {
+        crate::direct::advise_sequential(file);
+    }
+    // Note: --direct outranks the BOM sniff below, so -m/-w on a UTF-16
+    // file differ between --direct (byte semantics) and the default path
+    // (native code-unit semantics) — the cache-bypass contract wins.
+    #[cfg(target_os = "linux")]
+    if opts.direct && meta.len() > 0 {
+        return crate::direct::count_file_direct(file, meta.len(), selection);
+    }
+    if meta.len() >= 2 && utf16::supports(selection) {
+        let (header, n) = peek_header(file);
+        if let Some(endian) = utf16::detect_bom(&header[..n]) {
+            // A UTF-16 BOM means byte-oriented counts would be garbage;
+            // count code units natively instead of transcoding.
+            stats::bump(stats::Engine::Stream);
+            return utf16::count_file(file, endian, selection);
+        }
+    }
+    #[cfg(target_os = "linux")]
+    if opts.numa
+        && opts.threads > 1
+        && meta.len() >= parallel::PARALLEL_THRESHOLD
+        && parallel::supports(selection)
+    {
+        if let Some(counts) =
+            crate::numa::count_file_numa(file, meta.len(), selection, opts.threads)?
+        {
+            stats::bump(stats::Engine::Parallel);
+            return Ok(counts);
+        }
+    }
+    #[cfg(all(target_os = "linux", feature = "io_uring"))]
+    if opts.uring && meta.len() > 0 {
+        if let Some(counts) = crate::uring::try_count_file(file, meta.len(), selection)? {
+            stats::bump(stats::Engine::Uring);
+            return Ok(counts);
+        }
+    }
+    #[cfg(windows)]
+    if meta.len() >= MMAP_THRESHOLD {
+        // Overlapped positional reads keep NVMe and SMB links saturated in
+        // a way the synchronous portable path cannot.
+        stats::bump(stats::Engine::Stream);
+        return crate::windows::count_file_overlapped(file, meta.len(), selection);
+    }
+    if let Some(counts) = try_count_mmap(file, &meta, selection, opts)? {
+        return Ok(counts);
+    }
+    stats::bump(stats::Engine::Stream);
+    count_reader(file, selection, buf)
+}
+
+/// Opens an input path, applying the platform's sequential-scan open hint.
+pub fn open_input(path: &std::path::Path) -> io::Result<File> {
+    #[cfg(windows)]
+    return crate::windows::open_sequential(path);
+    #[cfg(not(windows))]
+    File::open(path)
+}
+
+/// Reads a file's first bytes without disturbing its read offset.
+fn peek_header(file: &mut File) -> ([u8; 4], usize) {
+    let mut header = [0u8; 4];
+    #[cfg(unix)]
+    let n = {
+        use std::os::unix::fs::FileExt;
+        file.read_at(&mut header, 0).unwrap_or(0)
+    };
+    #[cfg(not(unix))]
+    let n = {
+        use std::io::{Seek, SeekFrom};
+        let n = file.read(&mut header).unwrap_or(0);
+        if file.seek(SeekFrom::Start(0)).is_err() {
+            0
+        } else {
+            n
+        }
+    };
+    (header, n)
+}
+
+/// Sniffs a file's leading compression magic without moving its offset.
+fn sniff_file(file: &mut File) -> Option<compress::Kind> {
+    let (header, n) = peek_header(file);
+    compress::sniff(&header[..n])
+}
+
+fn try_count_mmap(
+    file: &File,
+    meta: &std::fs::Metadata,
+    selection: Selection,
+    opts: IoOptions,
+) -> io::Result<Option<Counts>> {
+    let threads = opts.threads;
+    if meta.len() < MMAP_THRESHOLD {
+        return Ok(None);
+    }
+    // Safety: the map is read-only and private. If another process truncates
+    // the file under us we would take SIGBUS, the same trade GNU grep and
+    // ripgrep accept for sequential scans.
+    let map = match unsafe { memmap2::Mmap::map(file) } {
+        Ok(map) => map,
+        Err(_) => return Ok(None),
+    };
+    #[cfg(unix)]
+    let _ = map.advise(memmap2::Advice::Sequential);
+    #[cfg(target_os = "linux")]
+    if opts.hugepages {
+        // Ask for THP collapse before any access so the fault path can
+        // build PMD mappings; whether the kernel granted any is reported
+        // through --stats after the scan.
+        unsafe {
+            libc::madvise(
+                map.as_ptr() as *mut libc::c_void,
+                map.len(),
+                libc::MADV_HUGEPAGE,
+            );
+        }
+    }
+    if threads > 1 && parallel::supports(selection) && meta.len() >= parallel::PARALLEL_THRESHOLD {
+        stats::bump(stats::Engine::Parallel);
+        let counts = parallel::count_slice(&map, selection, threads);
+        #[cfg(target_os = "linux")]
+        if opts.hugepages {
+            stats::set_thp_kb(thp_mapped_kb(map.as_ptr() as usize, map.len()));
+        }
+        return Ok(Some(counts));
+    }
+    stats::bump(stats::Engine::Mmap);
+    let mut counter = Counter::new(selection);
+    let counts = stats::timed_count(|| {
+        #[cfg(target_os = "linux")]
+        if opts.hugepages {
+            count_map_windowed(&map, &mut counter);
+        } else {
+            counter.feed(&map);
+        }
+        #[cfg(not(target_os = "linux"))]
+        counter.feed(&map);
+        counter.finish()
+    });
+    #[cfg(target_os = "linux")]
+    if opts.hugepages {
+        stats::set_thp_kb(thp_mapped_kb(map.as_ptr() as usize, map.len()));
+    }
+    Ok(Some(counts))
+}
+
+/// Counts a mapping in windows, staging MADV_WILLNEED one window ahead so
+/// readahead overlaps counting.
+#[cfg(target_os = "linux")]
+fn count_map_windowed(map: &[u8], counter: &mut Counter) {
+    const WINDOW: usize = 256 * 1024 * 1024;
+    let mut offset = 0;
+    while offset < map.len() {
+        let end = (offset + WINDOW).min(map.len());
+        let ahead_end = (end + WINDOW).min(map.len());
+        if ahead_end > end {
+            unsafe {
+                libc::madvise(
+                    map.as_ptr().add(end) as *mut libc::c_void,
+                    ahead_end - end,
+                    libc::MADV_WILLNEED,
+                );
+            }
+        }
+        counter.feed(&map[offset..end]);
+        offset = end;
+    }
+}
+
+/// Sums FilePmdMapped (file-backed THP) for the address range from
+/// /proc/self/smaps; zero when the kernel granted nothing.
+#[cfg(target_os = "linux")]
+fn thp_mapped_kb(addr: usize, len: usize) -> u64 {
+    let Ok(smaps) = std::fs::read_to_string("/proc/self/smaps") else {
+        return 0;
+    };
+    let mut in_range = false;
+    let mut total = 0u64;
+    for line in smaps.lines() {
+        if let Some((range, _)) = line.split_once(' ') {
+            if let Some((start, end)) = range.split_once('-') {
+                if let (Ok(start), Ok(end)) = (
+                    usize::from_str_radix(start, 16),
+                    usize::from_str_radix(end, 16),
+                ) {
+                    in_range = start >= addr && end <= addr + len + 4096;
+                    continue;
+                }
+            }
+        }
+        if in_range && (line.starts_with("FilePmdMapped:") || line.starts_with("AnonHugePages:")) {
+            if let Some(kb) = line
+                .split_whitespace()
+                .nth(1)
+                .and_then(|v| v.parse::<u64>().ok())
+            {
+                total += kb;
+            }
+        }
+    }
+    total
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn temp_file(name: &str, contents: &[u8]) -> (std::path::PathBuf, File) {
+        let path = std::env::temp_dir().join(format!("wc-rs-input-{}-{name}", std::process::id()));
+        std::fs::write(&path, contents).unwrap();
+        (path.clone(), File::open(&path).unwrap())
+    }
+
+    fn all_counters() -> Selection {
+        Selection {
+            lines: true,
+            words: true,
+            bytes: true,
+            chars: true,
+            max_line_length: true,
+        }
+    }
+
+    fn reference(contents: &[u8], selection: Selection) -> Counts {
+        let mut counter = Counter::new(selection);
+        counter.feed(contents);
+        counter.finish()
+    }
+
+    #[test]
+    fn small_file_streams() {
+        let (path, mut file) = temp_file("small", b"tiny\nfile\n");
+        let mut buf = vec![0u8; BUF_SIZE];
+        let counts = count_file(&mut file, all_counters(), IoOptions::default(), &mut buf).unwrap();
+        assert_eq!(counts, reference(b"tiny\nfile\n", all_counters()));
+        std::fs::remove_file(path).unwrap();
+    }
+
+    #[test]
+    fn large_file_uses_mmap_and_matches_streaming() {
+        let mut contents = Vec::with_capacity(2 * MMAP_THRESHOLD as usize);
+        while contents.len() < 2 * MMAP_THRESHOLD as usize {
+            contents.extend_from_slice(b"a line of filler text with words\n");
+        }
+        let (path, mut file) = temp_file("large", &contents);
+        assert!(file.metadata().unwrap().len() >= MMAP_THRESHOLD);
+
+        let meta = file.metadata().unwrap();
+        let mmap_counts = try_count_mmap(&file, &meta, all_counters(), IoOptions::default())
+            .unwrap()
+            .unwrap();
+        let mut buf = vec![0u8; BUF_SIZE];
+        let streamed = count_reader(&mut file, all_counters(), &mut buf).unwrap();
+        assert_eq!(mmap_counts, streamed);
+        std::fs::remove_file(path).unwrap();
+    }
+
+    #[test]
+    fn bytes_only_answers_from_metadata() {
+        let (path, mut file) = temp_file("bytes-only", b"0123456789");
+        let selection = Selection {
+            bytes: true,
+            ..Selection::default()
+        };
+        let mut buf = vec![0u8; 16];
+        // A buffer smaller than the file proves no read loop ran: the
+        // streaming path would still count correctly, but the fast path
+        // returns after a single fstat.
+        let counts = count_file(&mut file, selection, IoOptions::default(), &mut buf).unwrap();
+        assert_eq!(counts.bytes, 10);
+        assert_eq!(counts.lines, 0);
+        std::fs::remove_file(path).unwrap();
+    }
+
+    #[test]
+    fn pipe_like_input_streams() {
+        let mut cursor = io::Cursor::new(b"not a regular file\n".to_vec());
+        let mut buf = vec![0u8; BUF_SIZE];
+        let counts = count_reader(&mut cursor, all_counters(), &mut buf).unwrap();
+        assert_eq!(counts.lines, 1);
+        assert_eq!(counts.words, 4);
+    }
+}
@@ -0,0 +1,420 @@
+//! Byte-scanning kernels with runtime CPU dispatch.
+//!
+//! `count_byte` is the workhorse behind the `-l` path: it counts occurrences
+//! of a single byte (normally `\n`) in a buffer. On x86_64 it dispatches to an
+//! AVX-512BW or AVX2 kernel when the host supports one, on aarch64 it uses
+//! NEON (always available there), and everywhere else it falls back to a SWAR
+//! loop. Dispatch is resolved once per process and cached in a function
+//! pointer, so the per-call overhead is a single indirect call.
+
+/// Counts occurrences of `needle` in `haystack`.
+#[inline]
+pub fn count_byte(haystack: &[u8], needle: u8) -> u64 {
+    (select().count_byte)(haystack, needle)
+}
+
+/// Counts UTF-8 characters in `haystack`: every byte except continuation
+/// bytes (`0b10xxxxxx`) starts a character, so the count is length minus a
+/// popcount of continuation bytes. Exact for valid UTF-8; each byte of an
+/// invalid sequence counts as one character.
+#[inline]
+pub fn count_utf8_chars(haystack: &[u8]) -> u64 {
+    haystack.len() as u64 - (select().count_continuations)(haystack)
+}
+
+/// Name of the kernel variant selected for this host (for diagnostics).
+pub fn kernel_name() -> &'static str {
+    select().name
+}
+
+/// SWAR primitives shared by the scalar fallback here and the word/width
+/// modules: all-ones-per-byte and high-bit-per-byte constants, and the
+/// classic per-byte match masks built on the zero-byte test.
+pub(crate) mod swar {
+    pub const LO: u64 = 0x0101_0101_0101_0101;
+    pub const HI: u64 = 0x8080_8080_8080_8080;
+
+    /// 0x80 per byte that is zero. Carry-free and positionally exact: the
+    /// per-lane add of two 7-bit values cannot overflow a byte, unlike the
+    /// classic `(z - LO) & !z & HI` trick, whose borrow ripples into the
+    /// next lane and falsely flags it when that lane holds 0x01 (i.e. a
+    /// match followed by match+1 double-counted).
+    #[inline]
+    pub fn zero_mask(z: u64) -> u64 {
+        let low7 = z & !HI;
+        !((low7 + !HI) | z) & HI
+    }
+
+    /// 0x80 per byte equal to `x`.
+    #[inline]
+    pub fn eq_mask(w: u64, x: u8) -> u64 {
+        zero_mask(w ^ (LO.wrapping_mul(x as u64)))
+    }
+
+    /// 0x80 per byte strictly between `m` and `n` (m, n <= 127); bytes with
+    /// the high bit set never match.
+    #[inline]
+    pub fn between_mask(w: u64, m: u8, n: u8) -> u64 {
+        let x7 = w & !HI;
+        (LO.wrapping_mul(127 + n as u64).wrapping_sub(x7))
+            & !w
+            & (x7.wrapping_add(LO.wrapping_mul(127 - m as u64)))
+            & HI
+    }
+}
+
+type CountFn = fn(&[u8], u8) -> u64;
+type MaskCountFn = fn(&[u8]) -> u64;
+
+/// The kernel set chosen at first use; one runtime-dispatch decision covers
+/// every vector kernel.
+struct Kernels {
+    count_byte: CountFn,
+    count_continuations: MaskCountFn,
+    name: &'static str,
+}
+
+#[cfg(target_arch = "x86_64")]
+fn select() -> &'static Kernels {
+    use std::sync::OnceLock;
+    static SELECTED: OnceLock<Kernels> = OnceLock::new();
+    SELECTED.get_or_init(|| {
+        if is_x86_feature_detected!("avx512bw") {
+            Kernels {
+                count_byte: count_byte_avx512,
+                count_continuations: count_continuations_avx512,
+                name: "avx512bw",
+            }
+        } else if is_x86_feature_detected!("avx2") {
+            Kernels {
+                count_byte: count_byte_avx2,
+                count_continuations: count_continuations_avx2,
+                name: "avx2",
+            }
+        } else {
+            Kernels {
+                count_byte: count_byte_swar,
+                count_continuations: count_continuations_swar,
+                name: "swar",
+            }
+        }
+    })
+}
+
+#[cfg(target_arch = "aarch64")]
+fn select() -> &'static Kernels {
+    static SELECTED: Kernels = Kernels {
+        count_byte: count_byte_neon,
+        count_continuations: count_continuations_neon,
+        name: "neon",
+    };
+    &SELECTED
+}
+
+#[cfg(not(any(target_arch = "x86_64", target_arch = "aarch64")))]
+fn select() -> &'static Kernels {
+    static SELECTED: Kernels = Kernels {
+        count_byte: count_byte_swar,
+        count_continuations: count_continuations_swar,
+        name: "swar",
+    };
+    &SELECTED
+}
+
+/// Portable SWAR fallback: processes 8 bytes per iteration without branches
+/// by turning matches into 0x80 high bits and accumulating popcounts.
+fn count_byte_swar(haystack: &[u8], needle: u8) -> u64 {
+    let mut count = 0u64;
+    let (chunks, tail) = haystack.split_at(haystack.len() - haystack.len() % 8);
+    for chunk in chunks.chunks_exact(8) {
+        let word = u64::from_le_bytes(chunk.try_into().unwrap());
+        count += swar::eq_mask(word, needle).count_ones() as u64;
+    }
+    count + tail.iter().filter(|&&b| b == needle).count() as u64
+}
+
+/// SWAR continuation-byte popcount: a byte is a continuation iff
+/// `(b & 0xC0) == 0x80`.
+fn count_continuations_swar(haystack: &[u8]) -> u64 {
+    const TOP2: u64 = 0xC0C0_C0C0_C0C0_C0C0;
+    let mut count = 0u64;
+    let (chunks, tail) = haystack.split_at(haystack.len() - haystack.len() % 8);
+    for chunk in chunks.chunks_exact(8) {
+        let masked = u64::from_le_bytes(chunk.try_into().unwrap()) & TOP2;
+        count += swar::zero_mask(masked ^ swar::HI).count_ones() as u64;
+    }
+    count + tail.iter().filter(|&&b| b & 0xC0 == 0x80).count() as u64
+}
+
+#[cfg(target_arch = "x86_64")]
+fn count_continuations_avx2(haystack: &[u8]) -> u64 {
+    // Safety: only reachable after is_x86_feature_detected!("avx2").
+    unsafe { count_continuations_avx2_impl(haystack) }
+}
+
+#[cfg(target_arch = "x86_64")]
+#[target_feature(enable = "avx2")]
+unsafe fn count_continuations_avx2_impl(haystack: &[u8]) -> u64 {
+    use std::arch::x86_64::*;
+    const LANES: usize = 32;
+    let mask = _mm256_set1_epi8(0xC0u8 as i8);
+    let cont = _mm256_set1_epi8(0x80u8 as i8);
+    let mut count = 0u64;
+    let (chunks, tail) = haystack.split_at(haystack.len() - haystack.len() % LANES);
+    for chunk in chunks.chunks_exact(LANES) {
+        let block = _mm256_loadu_si256(chunk.as_ptr() as *const __m256i);
+        let eq = _mm256_cmpeq_epi8(_mm256_and_si256(block, mask), cont);
+        count += (_mm256_movemask_epi8(eq) as u32).count_ones() as u64;
+    }
+    count + tail.iter().filter(|&&b| b & 0xC0 == 0x80).count() as u64
+}
+
+#[cfg(target_arch = "x86_64")]
+fn count_continuations_avx512(haystack: &[u8]) -> u64 {
+    // Safety: only reachable after is_x86_feature_detected!("avx512bw").
+    unsafe { count_continuations_avx512_impl(haystack) }
+}
+
+#[cfg(target_arch = "x86_64")]
+#[target_feature(enable = "avx512bw")]
+unsafe fn count_continuations_avx512_impl(haystack: &[u8]) -> u64 {
+    use std::arch::x86_64::*;
+    const LANES: usize = 64;
+    let mask = _mm512_set1_epi8(0xC0u8 as i8);
+    let cont = _mm512_set1_epi8(0x80u8 as i8);
+    let mut count = 0u64;
+    let (chunks, tail) = haystack.split_at(haystack.len() - haystack.len() % LANES);
+    for chunk in chunks.chunks_exact(LANES) {
+        let block = _mm512_loadu_si512(chunk.as_ptr() as *const _);
+        count += _mm512_cmpeq_epi8_mask(_mm512_and_si512(block, mask), cont).count_ones() as u64;
+    }
+    count + tail.iter().filter(|&&b| b & 0xC0 == 0x80).count() as u64
+}
+
+#[cfg(target_arch = "aarch64")]
+fn count_continuations_neon(haystack: &[u8]) -> u64 {
+    // Safety: NEON is a baseline feature of aarch64.
+    unsafe { count_continuations_neon_impl(haystack) }
+}
+
+#[cfg(target_arch = "aarch64")]
+#[target_feature(enable = "neon")]
+unsafe fn count_continuations_neon_impl(haystack: &[u8]) -> u64 {
+    use std::arch::aarch64::*;
+    const LANES: usize = 16;
+    let mask = vdupq_n_u8(0xC0);
+    let cont = vdupq_n_u8(0x80);
+    let mut count = 0u64;
+    let (chunks, tail) = haystack.split_at(haystack.len() - haystack.len() % LANES);
+    let mut iter = chunks.chunks_exact(LANES);
+    'outer: loop {
+        let mut acc = vdupq_n_u8(0);
+        for _ in 0..128 {
+            let Some(chunk) = iter.next() else {
+                count += vaddlvq_u8(acc) as u64;
+                break 'outer;
+            };
+            let block = vld1q_u8(chunk.as_ptr());
+            let eq = vceqq_u8(vandq_u8(block, mask), cont);
+            acc = vsubq_u8(acc, eq);
+        }
+        count += vaddlvq_u8(acc) as u64;
+    }
+    count + tail.iter().filter(|&&b| b & 0xC0 == 0x80).count() as u64
+}
+
+#[cfg(target_arch = "x86_64")]
+fn count_byte_avx2(haystack: &[u8], needle: u8) -> u64 {
+    // Safety: only reachable after is_x86_feature_detected!("avx2").
+    unsafe { count_byte_avx2_impl(haystack, needle) }
+}
+
+#[cfg(target_arch = "x86_64")]
+#[target_feature(enable = "avx2")]
+unsafe fn count_byte_avx2_impl(haystack: &[u8], needle: u8) -> u64 {
+    use std::arch::x86_64::*;
+    const LANES: usize = 32;
+    let splat = _mm256_set1_epi8(needle as i8);
+    let mut count = 0u64;
+    let (chunks, tail) = haystack.split_at(haystack.len() - haystack.len() % LANES);
+    for chunk in chunks.chunks_exact(LANES) {
+        let block = _mm256_loadu_si256(chunk.as_ptr() as *const __m256i);
+        let eq = _mm256_cmpeq_epi8(block, splat);
+        count += (_mm256_movemask_epi8(eq) as u32).count_ones() as u64;
+    }
+    count + tail.iter().filter(|&&b| b == needle).count() as u64
+}
+
+#[cfg(target_arch = "x86_64")]
+fn count_byte_avx512(haystack: &[u8], needle: u8) -> u64 {
+    // Safety: only reachable after is_x86_feature_detected!("avx512bw").
+    unsafe { count_byte_avx512_impl(haystack, needle) }
+}
+
+#[cfg(target_arch = "x86_64")]
+#[target_feature(enable = "avx512bw")]
+unsafe fn count_byte_avx512_impl(haystack: &[u8], needle: u8) -> u64 {
+    use std::arch::x86_64::*;
+    const LANES: usize = 64;
+    let splat = _mm512_set1_epi8(needle as i8);
+    let mut count = 0u64;
+    let (chunks, tail) = haystack.split_at(haystack.len() - haystack.len() % LANES);
+    for chunk in chunks.chunks_exact(LANES) {
+        let block = _mm512_loadu_si512(chunk.as_ptr() as *const _);
+        count += _mm512_cmpeq_epi8_mask(block, splat).count_ones() as u64;
+    }
+    count + tail.iter().filter(|&&b| b == needle).count() as u64
+}
+
+#[cfg(target_arch = "aarch64")]
+fn count_byte_neon(haystack: &[u8], needle: u8) -> u64 {
+    // Safety: NEON is a baseline feature of aarch64.
+    unsafe { count_byte_neon_impl(haystack, needle) }
+}
+
+#[cfg(target_arch = "aarch64")]
+#[target_feature(enable = "neon")]
+unsafe fn count_byte_neon_impl(haystack: &[u8], needle: u8) -> u64 {
+    use std::arch::aarch64::*;
+    const LANES: usize = 16;
+    let splat = vdupq_n_u8(needle);
+    let mut count = 0u64;
+    let (chunks, tail) = haystack.split_at(haystack.len() - haystack.len() % LANES);
+    let mut iter = chunks.chunks_exact(LANES);
+    // Accumulate 0x01-per-match lanes in a vector register; u8 lanes hold up
+    // to 255 matches, so flush well before that.
+    'outer: loop {
+        let mut acc = vdupq_n_u8(0);
+        for _ in 0..128 {
+            let Some(chunk) = iter.next() else {
+                count += vaddlvq_u8(acc) as u64;
+                break 'outer;
+            };
+            let block = vld1q_u8(chunk.as_ptr());
+            let eq = vceqq_u8(block, splat);
+            acc = vsubq_u8(acc, eq); // 0xFF == -1, so subtracting adds 1
+        }
+        count += vaddlvq_u8(acc) as u64;
+    }
+    count + tail.iter().filter(|&&b| b == needle).count() as u64
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn reference(haystack: &[u8], needle: u8) -> u64 {
+        haystack.iter().filter(|&&b| b == needle).count() as u64
+    }
+
+    #[test]
+    fn empty_input() {
+        assert_eq!(count_byte(b"", b'\n'), 0);
+    }
+
+    #[test]
+    fn matches_reference_on_varied_inputs() {
+        let inputs: &[&[u8]] = &[
+            b"one\ntwo\nthree\n",
+            b"no newline at all",
+            b"\n\n\n\n",
+            b"trailing\n",
+            &[b'\n'; 1000],
+            &[0u8; 1000],
+        ];
+        for input in inputs {
+            assert_eq!(count_byte(input, b'\n'), reference(input, b'\n'));
+        }
+    }
+
+    #[test]
+    fn unaligned_lengths() {
+        // Exercise every tail length around the vector widths in use.
+        let data: Vec<u8> = (0..300u32)
+            .map(|i| if i % 7 == 0 { b'\n' } else { b'x' })
+            .collect();
+        for len in 0..data.len() {
+            assert_eq!(
+                count_byte(&data[..len], b'\n'),
+                reference(&data[..len], b'\n')
+            );
+        }
+    }
+
+    #[test]
+    fn swar_matches_reference_on_all_byte_pairs() {
+        // Every (byte, byte) adjacency: the borrow-rippling zero test this
+        // replaced double-counted a needle followed by needle+1 (for
+        // -l, a \n\v sequence), which a strided corpus can never place
+        // next to each other.
+        let mut data = Vec::with_capacity(256 * 256 * 2);
+        for a in 0..=255u8 {
+            for b in 0..=255u8 {
+                data.push(a);
+                data.push(b);
+            }
+        }
+        for needle in 0..=255u8 {
+            assert_eq!(
+                count_byte_swar(&data, needle),
+                reference(&data, needle),
+                "needle={needle:#x}"
+            );
+        }
+        assert_eq!(
+            count_continuations_swar(&data),
+            data.iter().filter(|&&b| b & 0xC0 == 0x80).count() as u64
+        );
+    }
+
+    #[test]
+    fn dispatched_kernel_handles_adjacent_needle_values() {
+        // The shipped dispatch (whatever variant this host picked) must
+        // agree on the \n\v adjacency as well.
+        assert_eq!(count_byte(b"\n\x0Bxxxxxx", b'\n'), 1);
+        assert_eq!(count_byte(&b"\n\x0B".repeat(1000), b'\n'), 1000);
+    }
+
+    fn char_reference(haystack: &[u8]) -> u64 {
+        haystack.iter().filter(|&&b| b & 0xC0 != 0x80).count() as u64
+    }
+
+    #[test]
+    fn utf8_chars_match_reference() {
+        let inputs: &[&[u8]] = &[
+            b"",
+            b"pure ascii text",
+            "héllo wörld ünïcode".as_bytes(),
+            "日本語テキストの行\n".as_bytes(),
+            &[0x80; 100],
+            &[0xC3, 0xA9, 0xE2, 0x82, 0xAC, 0xF0, 0x9F, 0x98, 0x80],
+        ];
+        for input in inputs {
+            assert_eq!(count_utf8_chars(input), char_reference(input));
+        }
+    }
+
+    #[test]
+    fn utf8_chars_unaligned_lengths() {
+        let data: Vec<u8> = (0..300u32).map(|i| (i * 37) as u8).collect();
+        for len in 0..data.len() {
+            assert_eq!(count_utf8_chars(&data[..len]), char_reference(&data[..len]));
+        }
+    }
+
+    #[test]
+    fn swar_continuations_match_reference() {
+        let data: Vec<u8> = (0..4096u32).map(|i| (i * 31 % 256) as u8).collect();
+        assert_eq!(
+            count_continuations_swar(&data),
+            data.len() as u64 - char_reference(&data)
+        );
+    }
+
+    #[test]
+    fn kernel_name_is_stable() {
+        let name = kernel_name();
+        assert!(["avx512bw", "avx2", "neon", "swar"].contains(&name));
+        assert_eq!(name, kernel_name());
+    }
+}
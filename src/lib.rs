@@ -0,0 +1,32 @@
+//! Core counting machinery for the `wc-rs` binary.
+//!
+//! The crate is split into a thin CLI front end (`main.rs`) and this library,
+//! so the hot loops can be unit-tested and benchmarked in isolation.
+
+#[cfg(unix)]
+pub mod cache;
+pub mod compress;
+pub mod counts;
+#[cfg(unix)]
+pub mod daemon;
+#[cfg(target_os = "linux")]
+pub mod direct;
+pub mod estimate;
+pub mod ffi;
+pub mod index;
+pub mod input;
+pub mod kernel;
+pub mod linelen;
+#[cfg(target_os = "linux")]
+pub mod numa;
+pub mod parallel;
+pub mod remote;
+pub mod scheduler;
+pub mod stats;
+pub mod stream;
+#[cfg(all(target_os = "linux", feature = "io_uring"))]
+pub mod uring;
+pub mod utf16;
+#[cfg(windows)]
+pub mod windows;
+pub mod word;
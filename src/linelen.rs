@@ -0,0 +1,347 @@
+//! Display-width tracking for `-L`.
+//!
+//! The old engine walked every byte through a fused loop. This one scans
+//! 8 bytes at a time: while a block is printable ASCII its width is its
+//! byte length, and newline positions (found with the same SWAR match
+//! masks the byte kernels use) turn into line widths by position delta.
+//! Only blocks containing a tab, control byte, or non-ASCII lead byte drop
+//! into the slow path, which decodes one item (tab stop, control, or UTF-8
+//! sequence with wcwidth semantics) and re-enters the fast loop.
+//!
+//! Width rules follow glibc wcwidth: tabs advance to the next 8-column
+//! stop, control bytes are width 0, combining marks and other zero-width
+//! characters are 0, East Asian wide/fullwidth characters are 2, and each
+//! byte of an invalid sequence counts as width 1 (consistent with how `-m`
+//! counts them as one character each).
+
+use crate::kernel::swar::{between_mask, eq_mask, HI};
+
+const TAB_WIDTH: u64 = 8;
+
+/// Character ranges rendered two columns wide (East Asian Wide and
+/// Fullwidth, per glibc wcwidth).
+const WIDE: &[(u32, u32)] = &[
+    (0x1100, 0x115F),
+    (0x2329, 0x232A),
+    (0x2E80, 0x303E),
+    (0x3041, 0x33FF),
+    (0x3400, 0x4DBF),
+    (0x4E00, 0x9FFF),
+    (0xA000, 0xA4CF),
+    (0xA960, 0xA97F),
+    (0xAC00, 0xD7A3),
+    (0xF900, 0xFAFF),
+    (0xFE10, 0xFE19),
+    (0xFE30, 0xFE52),
+    (0xFE54, 0xFE66),
+    (0xFE68, 0xFE6B),
+    (0xFF00, 0xFF60),
+    (0xFFE0, 0xFFE6),
+    (0x1F300, 0x1F64F),
+    (0x1F900, 0x1F9FF),
+    (0x20000, 0x2FFFD),
+    (0x30000, 0x3FFFD),
+];
+
+/// Zero-width characters: the common combining-mark blocks plus format
+/// controls. Not the full Unicode set, but covers the scripts our corpora
+/// contain; anything unlisted renders as width 1.
+const ZERO: &[(u32, u32)] = &[
+    (0x0300, 0x036F),
+    (0x0483, 0x0489),
+    (0x0591, 0x05BD),
+    (0x05BF, 0x05BF),
+    (0x0610, 0x061A),
+    (0x064B, 0x065F),
+    (0x0670, 0x0670),
+    (0x06D6, 0x06DC),
+    (0x0900, 0x0902),
+    (0x093C, 0x093C),
+    (0x0941, 0x0948),
+    (0x094D, 0x094D),
+    (0x0E31, 0x0E31),
+    (0x0E34, 0x0E3A),
+    (0x0E47, 0x0E4E),
+    (0x200B, 0x200F),
+    (0x202A, 0x202E),
+    (0x2060, 0x2064),
+    (0xFE00, 0xFE0F),
+    (0xFEFF, 0xFEFF),
+];
+
+fn in_ranges(ranges: &[(u32, u32)], c: u32) -> bool {
+    ranges
+        .binary_search_by(|&(lo, hi)| {
+            if hi < c {
+                std::cmp::Ordering::Less
+            } else if lo > c {
+                std::cmp::Ordering::Greater
+            } else {
+                std::cmp::Ordering::Equal
+            }
+        })
+        .is_ok()
+}
+
+fn char_width(c: u32) -> u64 {
+    if c < 0x20 || c == 0x7F {
+        0
+    } else if c < 0x80 {
+        1
+    } else if in_ranges(ZERO, c) {
+        0
+    } else if in_ranges(WIDE, c) {
+        2
+    } else {
+        1
+    }
+}
+
+/// Decodes one UTF-8 sequence starting at `buf[0]`; returns (codepoint,
+/// consumed bytes), or `None` for an invalid lead/continuation (caller
+/// charges one byte at width 1).
+fn decode_utf8(buf: &[u8]) -> Option<(u32, usize)> {
+    let lead = buf[0];
+    let (len, init) = match lead {
+        0xC2..=0xDF => (2, (lead & 0x1F) as u32),
+        0xE0..=0xEF => (3, (lead & 0x0F) as u32),
+        0xF0..=0xF4 => (4, (lead & 0x07) as u32),
+        _ => return None,
+    };
+    if buf.len() < len {
+        return None;
+    }
+    let mut c = init;
+    for &b in &buf[1..len] {
+        if b & 0xC0 != 0x80 {
+            return None;
+        }
+        c = (c << 6) | (b & 0x3F) as u32;
+    }
+    Some((c, len))
+}
+
+/// Streaming width state: carries the current line width and any trailing
+/// partial UTF-8 sequence across `feed` calls, so buffer boundaries never
+/// split a character.
+#[derive(Clone, Debug, Default)]
+pub struct WidthTracker {
+    width: u64,
+    pending: [u8; 4],
+    pending_len: usize,
+}
+
+impl WidthTracker {
+    pub fn feed(&mut self, buf: &[u8], max: &mut u64) {
+        let mut buf = buf;
+        if self.pending_len > 0 {
+            // Top up the held-back sequence and emit it once complete (or
+            // once it is provably invalid).
+            let needed = sequence_len(self.pending[0]).unwrap_or(1);
+            while self.pending_len < needed && !buf.is_empty() {
+                self.pending[self.pending_len] = buf[0];
+                self.pending_len += 1;
+                buf = &buf[1..];
+            }
+            if self.pending_len < needed {
+                return; // still incomplete; wait for more input
+            }
+            let pending = self.pending[..self.pending_len].to_owned();
+            self.pending_len = 0;
+            let mut i = 0;
+            while i < pending.len() {
+                i += slow_item(&pending[i..], &mut self.width, max);
+            }
+        }
+        let cut = holdback(buf);
+        self.width = advance(&buf[..cut], self.width, max);
+        self.pending[..buf.len() - cut].copy_from_slice(&buf[cut..]);
+        self.pending_len = buf.len() - cut;
+    }
+
+    /// Final width, with any dangling partial sequence charged as invalid
+    /// bytes (width 1 each, matching how `-m` counts them).
+    pub fn finish(mut self, max: &mut u64) -> u64 {
+        let pending = self.pending[..self.pending_len].to_owned();
+        let mut i = 0;
+        while i < pending.len() {
+            i += slow_item(&pending[i..], &mut self.width, max);
+        }
+        self.width
+    }
+}
+
+/// Bytes a sequence starting with `lead` occupies, if `lead` is a valid
+/// multi-byte lead.
+fn sequence_len(lead: u8) -> Option<usize> {
+    match lead {
+        0xC2..=0xDF => Some(2),
+        0xE0..=0xEF => Some(3),
+        0xF0..=0xF4 => Some(4),
+        _ => None,
+    }
+}
+
+/// Index before any trailing incomplete UTF-8 sequence in `buf`; bytes from
+/// there on must wait for the next feed.
+fn holdback(buf: &[u8]) -> usize {
+    for k in 1..=3.min(buf.len()) {
+        let b = buf[buf.len() - k];
+        if b & 0xC0 == 0x80 {
+            continue; // continuation; keep looking for its lead
+        }
+        if let Some(needed) = sequence_len(b) {
+            if needed > k {
+                return buf.len() - k;
+            }
+        }
+        break;
+    }
+    buf.len()
+}
+
+/// Feeds `buf` through the width tracker: `width` is the current line's
+/// width so far, `max` is raised as newlines complete lines. Returns the
+/// width after the final byte.
+fn advance(buf: &[u8], mut width: u64, max: &mut u64) -> u64 {
+    let mut i = 0;
+    while i + 8 <= buf.len() {
+        let w = u64::from_le_bytes(buf[i..i + 8].try_into().unwrap());
+        let printable = between_mask(w, 0x1F, 0x7F);
+        let newline = eq_mask(w, b'\n');
+        if printable | newline != HI {
+            // A tab, control byte, or non-ASCII byte: consume one item.
+            i += slow_item(&buf[i..], &mut width, max);
+            continue;
+        }
+        if newline == 0 {
+            width += 8;
+        } else {
+            let mut last = 0u64;
+            let mut m = newline;
+            while m != 0 {
+                let k = (m.trailing_zeros() / 8) as u64;
+                *max = (*max).max(width + (k - last));
+                width = 0;
+                last = k + 1;
+                m &= m - 1;
+            }
+            width += 8 - last;
+        }
+        i += 8;
+    }
+    while i < buf.len() {
+        i += slow_item(&buf[i..], &mut width, max);
+    }
+    width
+}
+
+/// Handles one item at `buf[0]` (never empty); returns bytes consumed.
+fn slow_item(buf: &[u8], width: &mut u64, max: &mut u64) -> usize {
+    let b = buf[0];
+    match b {
+        b'\n' => {
+            *max = (*max).max(*width);
+            *width = 0;
+            1
+        }
+        b'\t' => {
+            *width += TAB_WIDTH - *width % TAB_WIDTH;
+            1
+        }
+        0x20..=0x7E => {
+            *width += 1;
+            1
+        }
+        0x00..=0x1F | 0x7F => 1, // control: width 0
+        _ => match decode_utf8(buf) {
+            Some((c, len)) => {
+                *width += char_width(c);
+                len
+            }
+            None => {
+                *width += 1;
+                1
+            }
+        },
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn max_line_length(input: &[u8]) -> u64 {
+        let mut max = 0;
+        let mut tracker = WidthTracker::default();
+        tracker.feed(input, &mut max);
+        max.max(tracker.finish(&mut max))
+    }
+
+    #[test]
+    fn ascii_lines() {
+        assert_eq!(
+            max_line_length(b"short\na much longer line here\nmid\n"),
+            23
+        );
+        assert_eq!(max_line_length(b"no newline at all"), 17);
+        assert_eq!(max_line_length(b""), 0);
+    }
+
+    #[test]
+    fn tabs_advance_to_stops() {
+        assert_eq!(max_line_length(b"a\tb\n"), 9);
+        assert_eq!(max_line_length(b"\t\t\n"), 16);
+        assert_eq!(max_line_length(b"1234567\tx\n"), 9);
+    }
+
+    #[test]
+    fn wide_and_zero_width_characters() {
+        // 7 CJK chars at width 2 each.
+        assert_eq!(max_line_length("日本語テキスト\n".as_bytes()), 14);
+        // Combining acute: e + U+0301 renders one column.
+        assert_eq!(max_line_length("e\u{0301}x\n".as_bytes()), 2);
+        // Fullwidth digits.
+        assert_eq!(max_line_length("１２３\n".as_bytes()), 6);
+    }
+
+    #[test]
+    fn control_bytes_have_no_width() {
+        assert_eq!(max_line_length(b"ab\x01\x02cd\n"), 4);
+        assert_eq!(max_line_length(b"\rxy\n"), 2);
+    }
+
+    #[test]
+    fn state_carries_across_buffers() {
+        // Split at every position, including inside UTF-8 sequences: the
+        // tracker must hold back partial sequences and still see width 2
+        // for each CJK character ("abcdef" + 2*2 = 10).
+        let data = "abcdef日本\nxy\n".as_bytes();
+        for split in 0..data.len() {
+            let mut max = 0;
+            let mut tracker = WidthTracker::default();
+            tracker.feed(&data[..split], &mut max);
+            tracker.feed(&data[split..], &mut max);
+            assert_eq!(max.max(tracker.finish(&mut max)), 10, "split={split}");
+        }
+    }
+
+    #[test]
+    fn dangling_partial_sequence_at_eof() {
+        let mut max = 0;
+        let mut tracker = WidthTracker::default();
+        tracker.feed(&[b'a', 0xE6, 0x97], &mut max); // truncated 日
+                                                     // The two dangling bytes are charged as invalid: width 1 each.
+        assert_eq!(max.max(tracker.finish(&mut max)), 3);
+    }
+
+    #[test]
+    fn newline_positions_at_every_offset() {
+        for offset in 0..24 {
+            let mut input = vec![b'x'; 24];
+            input[offset] = b'\n';
+            let expected = offset.max(24 - offset - 1) as u64;
+            assert_eq!(max_line_length(&input), expected, "offset={offset}");
+        }
+    }
+}
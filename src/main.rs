@@ -0,0 +1,1135 @@
+//! `wc-rs` — a fast wc(1) reimplementation.
+
+use std::ffi::{OsStr, OsString};
+use std::fs::File;
+use std::io::{self, BufRead, Write};
+use std::path::{Path, PathBuf};
+use std::process::ExitCode;
+
+#[cfg(unix)]
+use wc::cache::Cache;
+use wc::compress;
+use wc::counts::{Counts, Delims, Selection};
+#[cfg(unix)]
+use wc::daemon;
+use wc::estimate;
+use wc::index;
+use wc::input::{self, IoOptions, BUF_SIZE};
+use wc::remote;
+use wc::scheduler;
+use wc::stats;
+use wc::stream;
+
+enum Input {
+    /// Standard input; `explicit` records whether `-` appeared on the
+    /// command line (GNU wc labels that row `-`, but leaves the implicit
+    /// no-arguments case unlabelled).
+    Stdin { explicit: bool },
+    /// A path operand, kept as raw OS bytes: non-UTF-8 file names are
+    /// legal on Unix and must open and print without mangling.
+    Path(PathBuf),
+}
+
+impl Input {
+    fn display_name(&self) -> Option<&OsStr> {
+        match self {
+            Input::Stdin { explicit } => explicit.then_some(OsStr::new("-")),
+            Input::Path(path) => Some(path.as_os_str()),
+        }
+    }
+
+    /// URL operands are necessarily UTF-8; everything else is a file path.
+    fn as_url(&self) -> Option<&str> {
+        match self {
+            Input::Path(path) => path
+                .to_str()
+                .filter(|s| s.starts_with("http://") || s.starts_with("https://")),
+            Input::Stdin { .. } => None,
+        }
+    }
+}
+
+#[derive(Clone, Copy, PartialEq, Eq)]
+enum OutputFormat {
+    Human,
+    Json,
+    Tsv,
+}
+
+struct Options {
+    selection: Selection,
+    inputs: Vec<Input>,
+    /// Worker threads for the parallel engine; defaults to the detected
+    /// core count.
+    threads: usize,
+    /// Prefer the io_uring engine on Linux; ignored where unsupported.
+    uring: bool,
+    /// Decompress gzip/zstd inputs detected by magic bytes.
+    decompress: bool,
+    /// Bypass the page cache with O_DIRECT where supported.
+    direct: bool,
+    /// NUMA-aware placement for the parallel engine.
+    numa: bool,
+    /// Transparent hugepage tuning for the mmap engine.
+    hugepages: bool,
+    /// Emit a machine-readable self-report to stderr on exit.
+    stats: bool,
+    /// Record format for stdout.
+    format: OutputFormat,
+    /// Sampling confidence for --estimate; None means exact counting.
+    estimate: Option<f64>,
+    /// Maintain append-only count-index sidecars (`--index`).
+    index: bool,
+    /// Path of the incremental recount index (`--cache`).
+    cache: Option<String>,
+    /// NUL-delimited file list to stream (`--files0-from`); `-` is stdin.
+    files0_from: Option<String>,
+}
+
+impl Options {
+    fn io_options(&self) -> IoOptions {
+        IoOptions {
+            threads: self.threads,
+            uring: self.uring,
+            decompress: self.decompress,
+            direct: self.direct,
+            numa: self.numa,
+            hugepages: self.hugepages,
+        }
+    }
+}
+
+fn usage() -> &'static str {
+    "Usage: wc-rs [OPTION]... [FILE]...\n\
+     Print newline, word, and byte counts for each FILE, and a total line if\n\
+     more than one FILE is specified. With no FILE, or when FILE is -, read\n\
+     standard input.\n\n\
+       -c, --bytes            print the byte counts\n\
+       -m, --chars            print the character counts\n\
+       -l, --lines            print the newline counts\n\
+       -w, --words            print the word counts\n\
+       -L, --max-line-length  print the maximum display width\n\
+           --threads=N        worker threads for large files (default: cores)\n\
+           --io-uring         use the io_uring engine on Linux when available\n\
+           --decompress       count gzip/zstd inputs after decompressing\n\
+           --direct           bypass the page cache for one-shot cold scans\n\
+           --numa             pin workers and buffers per NUMA node (Linux)\n\
+           --hugepages        madvise THP and staged readahead for mmap scans\n\
+           --stats            emit a machine-readable self-report to stderr\n\
+           --format=FMT       output records as json or tsv instead of text\n\
+           --line-delim=BYTE  count records ending in BYTE instead of newline\n\
+           --word-delims=SET  treat exactly the bytes in SET as separators\n\
+           --estimate[=CONF]  sample large files and extrapolate (default 0.95)\n\
+           --index            keep .wcidx sidecars and resume appended logs\n\
+           --daemon[=SOCK]    serve requests on a Unix socket (Unix only)\n\
+           --client[=SOCK]    forward this invocation to a running daemon\n\
+           --cache=PATH       reuse counts for unchanged files via an index\n\
+           --files0-from=F    read NUL-terminated names from F (- for stdin)\n\
+           --help             display this help and exit\n\
+           --version          output version information and exit"
+}
+
+/// Parses a byte spec: a single byte, or an escape (\\0 \\n \\t \\r \\\\
+/// \\xNN).
+fn parse_byte(spec: &str) -> Result<u8, String> {
+    let bytes = spec.as_bytes();
+    match bytes {
+        [b] => Ok(*b),
+        [b'\\', b'0'] => Ok(0),
+        [b'\\', b'n'] => Ok(b'\n'),
+        [b'\\', b't'] => Ok(b'\t'),
+        [b'\\', b'r'] => Ok(b'\r'),
+        [b'\\', b'\\'] => Ok(b'\\'),
+        [b'\\', b'x', hex @ ..] if hex.len() == 2 => {
+            u8::from_str_radix(std::str::from_utf8(hex).unwrap_or("zz"), 16)
+                .map_err(|_| format!("invalid byte spec '{spec}'"))
+        }
+        _ => Err(format!("invalid byte spec '{spec}'")),
+    }
+}
+
+/// Parses a set of byte specs: plain bytes and escapes concatenated, e.g.
+/// `,;\\t` or `\\0`.
+fn parse_byte_set(spec: &str) -> Result<Vec<u8>, String> {
+    let mut bytes = Vec::new();
+    let mut rest = spec.as_bytes();
+    while !rest.is_empty() {
+        let take = if rest[0] == b'\\' {
+            if rest.len() >= 4 && rest[1] == b'x' {
+                4
+            } else if rest.len() >= 2 {
+                2
+            } else {
+                1
+            }
+        } else {
+            1
+        };
+        let (head, tail) = rest.split_at(take.min(rest.len()));
+        bytes.push(parse_byte(
+            std::str::from_utf8(head).map_err(|_| format!("invalid byte spec in '{spec}'"))?,
+        )?);
+        rest = tail;
+    }
+    if bytes.is_empty() {
+        return Err("empty delimiter set".into());
+    }
+    Ok(bytes)
+}
+
+fn parse_threads(value: &str) -> Result<usize, String> {
+    match value.parse::<usize>() {
+        Ok(n) if n >= 1 => Ok(n),
+        _ => Err(format!("invalid number of threads: '{value}'")),
+    }
+}
+
+fn parse_args(mut args: impl Iterator<Item = OsString>) -> Result<Options, String> {
+    let mut selection = Selection::default();
+    let mut inputs = Vec::new();
+    let mut no_more_flags = false;
+    let mut threads = None;
+    let mut uring = false;
+    let mut decompress = false;
+    let mut direct = false;
+    let mut numa = false;
+    let mut hugepages = false;
+    let mut emit_stats = false;
+    let mut format = OutputFormat::Human;
+    let mut estimate = None;
+    let mut index = false;
+    let mut line_delim = None;
+    let mut word_delims = None;
+    let mut cache = None;
+    let mut files0_from = None;
+
+    while let Some(os_arg) = args.next() {
+        // Flags are ASCII; anything that is not valid UTF-8 can only be a
+        // path operand and must pass through without mangling (or the
+        // panic std::env::args would have produced here).
+        let Some(arg) = os_arg.to_str().map(str::to_owned) else {
+            inputs.push(Input::Path(PathBuf::from(os_arg)));
+            continue;
+        };
+        if no_more_flags || arg == "-" || !arg.starts_with('-') {
+            inputs.push(if arg == "-" {
+                Input::Stdin { explicit: true }
+            } else {
+                Input::Path(PathBuf::from(arg))
+            });
+            continue;
+        }
+        match arg.as_str() {
+            "--" => no_more_flags = true,
+            "--bytes" => selection.bytes = true,
+            "--chars" => selection.chars = true,
+            "--lines" => selection.lines = true,
+            "--words" => selection.words = true,
+            "--max-line-length" => selection.max_line_length = true,
+            "--io-uring" => uring = true,
+            "--decompress" => decompress = true,
+            "--direct" => direct = true,
+            "--numa" => numa = true,
+            "--hugepages" => hugepages = true,
+            "--stats" => emit_stats = true,
+            "--estimate" => estimate = Some(0.95),
+            "--index" => index = true,
+            "--files0-from" => {
+                files0_from = Some(
+                    args.next()
+                        .and_then(|v| v.into_string().ok())
+                        .ok_or("option '--files0-from' requires an argument")?,
+                );
+            }
+            "--cache" => {
+                cache = Some(
+                    args.next()
+                        .and_then(|v| v.into_string().ok())
+                        .ok_or("option '--cache' requires an argument")?,
+                );
+            }
+            "--threads" => {
+                let value = args
+                    .next()
+                    .and_then(|v| v.into_string().ok())
+                    .ok_or("option '--threads' requires an argument")?;
+                threads = Some(parse_threads(&value)?);
+            }
+            "--help" => return Err("help".into()),
+            "--version" => return Err("version".into()),
+            long if long.starts_with("--files0-from=") => {
+                files0_from = Some(long["--files0-from=".len()..].to_owned());
+            }
+            long if long.starts_with("--estimate=") => {
+                let value = &long["--estimate=".len()..];
+                estimate = match value.parse::<f64>() {
+                    Ok(c) if (0.5..1.0).contains(&c) => Some(c),
+                    _ => return Err(format!("invalid confidence '{value}' (want 0.5..1.0)")),
+                };
+            }
+            long if long.starts_with("--line-delim=") => {
+                line_delim = Some(parse_byte(&long["--line-delim=".len()..])?);
+            }
+            long if long.starts_with("--word-delims=") => {
+                word_delims = Some(parse_byte_set(&long["--word-delims=".len()..])?);
+            }
+            long if long.starts_with("--format=") => {
+                format = match &long["--format=".len()..] {
+                    "json" => OutputFormat::Json,
+                    "tsv" => OutputFormat::Tsv,
+                    other => return Err(format!("invalid output format '{other}'")),
+                };
+            }
+            long if long.starts_with("--cache=") => {
+                cache = Some(long["--cache=".len()..].to_owned());
+            }
+            long if long.starts_with("--threads=") => {
+                threads = Some(parse_threads(&long["--threads=".len()..])?);
+            }
+            long if long.starts_with("--") => {
+                return Err(format!("unrecognized option '{long}'"));
+            }
+            short => {
+                for flag in short.chars().skip(1) {
+                    match flag {
+                        'c' => selection.bytes = true,
+                        'm' => selection.chars = true,
+                        'l' => selection.lines = true,
+                        'w' => selection.words = true,
+                        'L' => selection.max_line_length = true,
+                        other => return Err(format!("invalid option -- '{other}'")),
+                    }
+                }
+            }
+        }
+    }
+
+    if !selection.any() {
+        selection = Selection::default_counters();
+    }
+    if estimate.is_some() && selection.max_line_length {
+        return Err("--estimate cannot be combined with -L".into());
+    }
+    if index && selection.max_line_length {
+        return Err("--index cannot be combined with -L".into());
+    }
+    if line_delim.is_some() && selection.max_line_length {
+        return Err("--line-delim cannot be combined with -L".into());
+    }
+    if line_delim.is_some() || word_delims.is_some() {
+        wc::counts::set_delims(Delims {
+            line: line_delim.unwrap_or(b'\n'),
+            word_separators: word_delims.map(wc::word::separator_bitmap),
+        });
+    }
+    if files0_from.is_some() && !inputs.is_empty() {
+        return Err("file operands cannot be combined with --files0-from".into());
+    }
+    if files0_from.is_none() && inputs.is_empty() {
+        inputs.push(Input::Stdin { explicit: false });
+    }
+    let threads =
+        threads.unwrap_or_else(|| std::thread::available_parallelism().map_or(1, |n| n.get()));
+    if cache.is_some() && !cfg!(unix) {
+        return Err("option '--cache' is only supported on Unix systems".into());
+    }
+    Ok(Options {
+        selection,
+        inputs,
+        threads,
+        uring,
+        decompress,
+        direct,
+        numa,
+        hugepages,
+        stats: emit_stats,
+        format,
+        estimate,
+        index,
+        cache,
+        files0_from,
+    })
+}
+
+/// Counts one path under --index: regular files resume from their sidecar
+/// checkpoints; everything else counts normally.
+fn count_path_indexed(
+    path: &Path,
+    selection: Selection,
+    opts: IoOptions,
+    buf: &mut [u8],
+) -> io::Result<Counts> {
+    let mut file = input::open_input(path)?;
+    let meta = file.metadata()?;
+    if meta.is_file() && index::supports(selection) {
+        return index::count_file_indexed(path, &file, meta.len(), selection);
+    }
+    input::count_file(&mut file, selection, opts, buf)
+}
+
+/// Counts one path under --estimate: large regular files are sampled and
+/// marked, everything else counts exactly.
+fn estimate_input(
+    path: &Path,
+    selection: Selection,
+    confidence: f64,
+    opts: IoOptions,
+    buf: &mut [u8],
+) -> io::Result<(Counts, Option<(f64, f64)>)> {
+    let mut file = input::open_input(path)?;
+    let meta = file.metadata()?;
+    if meta.is_file() && meta.len() >= estimate::ESTIMATE_MIN {
+        let est = estimate::estimate_file(&file, meta.len(), selection, confidence)?;
+        return Ok((est.counts, Some((est.moe_percent, est.confidence))));
+    }
+    Ok((input::count_file(&mut file, selection, opts, buf)?, None))
+}
+
+/// Counts one path through the recount index: serve unchanged regular
+/// files from the cache, count everything else and record the result.
+#[cfg(unix)]
+fn count_path_cached(
+    path: &Path,
+    selection: Selection,
+    opts: IoOptions,
+    cache: &mut Cache,
+    buf: &mut [u8],
+) -> io::Result<Counts> {
+    let mut file = input::open_input(path)?;
+    let meta = file.metadata()?;
+    if meta.is_file() {
+        if let Some(counts) = cache.lookup(&meta, selection) {
+            stats::cache_hit();
+            return Ok(counts);
+        }
+        stats::cache_miss();
+    }
+    let counts = input::count_file(&mut file, selection, opts, buf)?;
+    if meta.is_file() {
+        cache.update(&meta, selection, &counts);
+    }
+    Ok(counts)
+}
+
+fn count_input(
+    input: &Input,
+    selection: Selection,
+    opts: IoOptions,
+    buf: &mut [u8],
+) -> io::Result<Counts> {
+    match input {
+        // `Stdin` rather than `StdinLock`: the lock guard is not `Send`, and
+        // the overlapped reader fills 256 KiB per read so per-call locking
+        // is noise.
+        Input::Stdin { .. } if opts.decompress => {
+            stats::bump(stats::Engine::Decompressed);
+            compress::count_maybe_compressed(io::stdin(), selection)
+        }
+        Input::Stdin { .. } => {
+            stats::bump(stats::Engine::Stream);
+            stream::count_reader_overlapped(&mut io::stdin(), selection)
+        }
+        Input::Path(path) => match input.as_url() {
+            Some(url) => remote::count_url(url, selection, opts.threads),
+            None => input::count_file(&mut input::open_input(path)?, selection, opts, buf),
+        },
+    }
+}
+
+/// Size of stdin when it is a redirected regular file (GNU wc sizes its
+/// output columns from it); pipes and terminals report None.
+fn stdin_regular_size() -> Option<u64> {
+    #[cfg(unix)]
+    {
+        use std::mem::ManuallyDrop;
+        use std::os::unix::io::FromRawFd;
+        // Borrow fd 0 without taking ownership; ManuallyDrop keeps it open.
+        let stdin = ManuallyDrop::new(unsafe { File::from_raw_fd(0) });
+        match stdin.metadata() {
+            Ok(meta) if meta.is_file() => Some(meta.len()),
+            _ => None,
+        }
+    }
+    #[cfg(not(unix))]
+    None
+}
+
+/// Column width for the printed numbers, following GNU wc: a bare number for
+/// a single counter over a single input, otherwise wide enough for the sum
+/// of the regular input sizes (minimum 7 when any input size is unknown).
+fn number_width(options: &Options) -> usize {
+    if options.inputs.len() == 1 && options.selection.count_enabled() == 1 {
+        return 1;
+    }
+    let mut total: u64 = 0;
+    let mut unknown = false;
+    for input in &options.inputs {
+        match input {
+            Input::Path(_) if input.as_url().is_some() => unknown = true,
+            Input::Path(path) => match std::fs::metadata(path) {
+                Ok(meta) if meta.is_file() => total += meta.len(),
+                _ => unknown = true,
+            },
+            Input::Stdin { .. } => match stdin_regular_size() {
+                Some(size) => total += size,
+                None => unknown = true,
+            },
+        }
+    }
+    let digits = total.max(1).ilog10() as usize + 1;
+    if unknown {
+        digits.max(7)
+    } else {
+        digits
+    }
+}
+
+/// Selected (label, value) pairs in GNU column order, without building a
+/// per-record collection: the multi-file loop calls this millions of times.
+fn selected_fields(counts: &Counts, selection: Selection) -> ([(&'static str, u64); 5], usize) {
+    let mut fields = [("", 0u64); 5];
+    let mut n = 0;
+    let mut push = |label, value| {
+        fields[n] = (label, value);
+        n += 1;
+    };
+    if selection.lines {
+        push("lines", counts.lines);
+    }
+    if selection.words {
+        push("words", counts.words);
+    }
+    if selection.chars {
+        push("chars", counts.chars);
+    }
+    if selection.bytes {
+        push("bytes", counts.bytes);
+    }
+    if selection.max_line_length {
+        push("max_line_length", counts.max_line_length);
+    }
+    (fields, n)
+}
+
+fn json_escape(out: &mut String, name: &str) {
+    for c in name.chars() {
+        match c {
+            '"' => out.push_str("\\\""),
+            '\\' => out.push_str("\\\\"),
+            c if (c as u32) < 0x20 => out.push_str(&format!("\\u{:04x}", c as u32)),
+            c => out.push(c),
+        }
+    }
+}
+
+struct RecordWriter<W: Write> {
+    out: W,
+    format: OutputFormat,
+    width: usize,
+    /// Reused per-record scratch for the JSON format; steady-state output
+    /// must not allocate per file.
+    scratch: String,
+}
+
+impl<W: Write> RecordWriter<W> {
+    fn new(out: W, format: OutputFormat, width: usize) -> Self {
+        RecordWriter {
+            out,
+            format,
+            width,
+            scratch: String::with_capacity(128),
+        }
+    }
+
+    /// Writes one record; `name` is None for unlabelled stdin, `is_total`
+    /// marks the aggregate record distinctly in every format, and
+    /// `estimate` carries (margin-of-error %, confidence) for sampled
+    /// results, which every format flags explicitly.
+    fn write(
+        &mut self,
+        counts: &Counts,
+        selection: Selection,
+        name: Option<&OsStr>,
+        is_total: bool,
+        estimate: Option<(f64, f64)>,
+    ) -> io::Result<()> {
+        let (fields, nfields) = selected_fields(counts, selection);
+        let fields = &fields[..nfields];
+        match self.format {
+            OutputFormat::Human => {
+                let name = if is_total {
+                    Some(OsStr::new("total"))
+                } else {
+                    name
+                };
+                let width = self.width;
+                for (i, (_, value)) in fields.iter().enumerate() {
+                    if i > 0 {
+                        write!(self.out, " ")?;
+                    }
+                    write!(self.out, "{value:>width$}")?;
+                }
+                if let Some(name) = name {
+                    write!(self.out, " {}", Path::new(name).display())?;
+                }
+                if let Some((moe, conf)) = estimate {
+                    write!(
+                        self.out,
+                        " [estimate \u{00b1}{moe:.2}% @ {:.0}%]",
+                        conf * 100.0
+                    )?;
+                }
+                writeln!(self.out)
+            }
+            OutputFormat::Json => {
+                use std::fmt::Write as _;
+                let line = &mut self.scratch;
+                line.clear();
+                line.push('{');
+                match name {
+                    Some(name) => {
+                        line.push_str("\"file\":\"");
+                        json_escape(line, &name.to_string_lossy());
+                        line.push('"');
+                    }
+                    None => line.push_str("\"file\":null"),
+                }
+                if is_total {
+                    line.push_str(",\"total\":true");
+                }
+                if let Some((moe, conf)) = estimate {
+                    let _ = write!(
+                        line,
+                        ",\"estimate\":true,\"moe_percent\":{moe:.3},\"confidence\":{conf}"
+                    );
+                }
+                for (label, value) in fields {
+                    let _ = write!(line, ",\"{label}\":{value}");
+                }
+                line.push('}');
+                writeln!(self.out, "{line}")
+            }
+            OutputFormat::Tsv => {
+                let kind = match (is_total, estimate.is_some()) {
+                    (true, true) => "total~",
+                    (true, false) => "total",
+                    (false, true) => "file~",
+                    (false, false) => "file",
+                };
+                write!(
+                    self.out,
+                    "{kind}\t{}",
+                    Path::new(name.unwrap_or(OsStr::new("-"))).display()
+                )?;
+                for (_, value) in fields {
+                    write!(self.out, "\t{value}")?;
+                }
+                writeln!(self.out)
+            }
+        }
+    }
+
+    fn flush(&mut self) -> io::Result<()> {
+        self.out.flush()
+    }
+}
+
+/// The multi-file scheduler applies when every input is a path; a stdin
+/// operand forces the serial loop so consumption order stays well-defined,
+/// and --cache does too so index lookups and updates stay single-threaded.
+fn scheduler_paths(options: &Options) -> Option<Vec<&Path>> {
+    if options.threads <= 1
+        || options.inputs.len() <= 1
+        || options.cache.is_some()
+        || options.estimate.is_some()
+        || options.index
+    {
+        return None;
+    }
+    options
+        .inputs
+        .iter()
+        .map(|input| match input {
+            Input::Path(path)
+                if path
+                    .to_str()
+                    .is_some_and(|s| s.starts_with("http://") || s.starts_with("https://")) =>
+            {
+                None
+            }
+            Input::Path(path) => Some(path.as_path()),
+            Input::Stdin { .. } => None,
+        })
+        .collect()
+}
+
+/// Batch size for --files0-from: bounds memory no matter how long the list
+/// runs, and hands the scheduler enough files to keep dozens in flight.
+const FILES0_BATCH: usize = 4096;
+
+/// Streams a NUL-delimited name list without ever materializing it,
+/// counting each batch through the multi-file scheduler (or serially when
+/// --cache is active). Parsing and counting alternate per batch; the
+/// pipelining the request asked for happens inside each batch, where the
+/// scheduler keeps dozens of stat/open/read/close sequences in flight.
+/// Parsing 4096 names is microseconds against counting them, so
+/// overlapping the two phases across batches would buy noise.
+fn run_files0(
+    options: &Options,
+    source: &str,
+    out: impl Write,
+    err: &mut dyn Write,
+) -> io::Result<bool> {
+    let stdin = io::stdin();
+    let mut reader: Box<dyn BufRead> = if source == "-" {
+        Box::new(stdin.lock())
+    } else {
+        Box::new(io::BufReader::new(File::open(source).map_err(|e| {
+            io::Error::new(e.kind(), format!("{source}: {e}"))
+        })?))
+    };
+
+    // List length is unknown up front; use GNU's unknown-size column width.
+    let mut out = RecordWriter::new(
+        io::BufWriter::with_capacity(OUT_BUF_SIZE, out),
+        options.format,
+        7,
+    );
+    let mut total = Counts::default();
+    let mut ok = true;
+    let mut file_count: u64 = 0;
+    #[cfg(unix)]
+    let mut cache = options
+        .cache
+        .as_ref()
+        .map(|path| Cache::load(std::path::Path::new(path)));
+    let mut buf = vec![0u8; BUF_SIZE];
+
+    let mut name = Vec::new();
+    // Batch names live in a reused byte arena (one backing buffer plus
+    // spans) instead of an allocation per path: tens of millions of
+    // entries stream through with zero steady-state allocation, and on
+    // Unix the raw bytes round-trip exactly, so non-UTF-8 names from
+    // `find -print0` open unmangled.
+    let mut arena: Vec<u8> = Vec::new();
+    let mut spans: Vec<(usize, usize)> = Vec::with_capacity(FILES0_BATCH);
+    let mut done = false;
+    while !done {
+        // Parse one bounded batch into the arena.
+        arena.clear();
+        spans.clear();
+        while spans.len() < FILES0_BATCH {
+            name.clear();
+            let n = reader.read_until(0, &mut name)?;
+            if n == 0 {
+                done = true;
+                break;
+            }
+            if name.last() == Some(&0) {
+                name.pop();
+            }
+            if name.is_empty() {
+                let _ = writeln!(err, "wc-rs: invalid zero-length file name");
+                ok = false;
+                continue;
+            }
+            let start = arena.len();
+            arena.extend_from_slice(&name);
+            spans.push((start, arena.len()));
+        }
+        #[cfg(unix)]
+        let batch: Vec<&Path> = {
+            use std::os::unix::ffi::OsStrExt;
+            spans
+                .iter()
+                .map(|&(s, e)| Path::new(OsStr::from_bytes(&arena[s..e])))
+                .collect()
+        };
+        #[cfg(not(unix))]
+        let owned: Vec<PathBuf> = spans
+            .iter()
+            .map(|&(s, e)| PathBuf::from(String::from_utf8_lossy(&arena[s..e]).into_owned()))
+            .collect();
+        #[cfg(not(unix))]
+        let batch: Vec<&Path> = owned.iter().map(PathBuf::as_path).collect();
+
+        #[cfg(unix)]
+        if let Some(cache) = cache.as_mut() {
+            for &path in &batch {
+                file_count += 1;
+                match count_path_cached(
+                    path,
+                    options.selection,
+                    options.io_options(),
+                    cache,
+                    &mut buf,
+                ) {
+                    Ok(counts) => {
+                        total.add(&counts);
+                        out.write(
+                            &counts,
+                            options.selection,
+                            Some(path.as_os_str()),
+                            false,
+                            None,
+                        )?;
+                    }
+                    Err(e) => {
+                        let _ = writeln!(err, "wc-rs: {}: {e}", path.display());
+                        ok = false;
+                    }
+                }
+            }
+            continue;
+        }
+
+        let mut write_error = None;
+        scheduler::count_files(
+            &batch,
+            options.selection,
+            options.io_options(),
+            |index, result| {
+                file_count += 1;
+                match result {
+                    Ok(counts) => {
+                        total.add(&counts);
+                        if write_error.is_none() {
+                            if let Err(e) = out.write(
+                                &counts,
+                                options.selection,
+                                Some(batch[index].as_os_str()),
+                                false,
+                                None,
+                            ) {
+                                write_error = Some(e);
+                            }
+                        }
+                    }
+                    Err(e) => {
+                        let _ = writeln!(err, "wc-rs: {}: {e}", batch[index].display());
+                        ok = false;
+                    }
+                }
+            },
+        );
+        if let Some(e) = write_error {
+            return Err(e);
+        }
+    }
+
+    if file_count > 1 {
+        out.write(&total, options.selection, None, true, None)?;
+    }
+    out.flush()?;
+    #[cfg(unix)]
+    if let Some(cache) = cache {
+        if let Err(e) = cache.save() {
+            let _ = writeln!(err, "wc-rs: failed to write cache: {e}");
+        }
+    }
+    Ok(ok)
+}
+
+/// Output buffer size: large batches collapse millions of per-record
+/// writes into few syscalls.
+const OUT_BUF_SIZE: usize = 1 << 20;
+
+fn run(options: &Options, out: impl Write, err: &mut dyn Write) -> io::Result<bool> {
+    let width = number_width(options);
+    let mut out = RecordWriter::new(
+        io::BufWriter::with_capacity(OUT_BUF_SIZE, out),
+        options.format,
+        width,
+    );
+    let mut total = Counts::default();
+    let mut ok = true;
+    let mut estimated: Option<f64> = None;
+    #[cfg(unix)]
+    let mut cache = options
+        .cache
+        .as_ref()
+        .map(|path| Cache::load(std::path::Path::new(path)));
+
+    if let Some(paths) = scheduler_paths(options) {
+        let mut write_error = None;
+        scheduler::count_files(
+            &paths,
+            options.selection,
+            options.io_options(),
+            |index, result| match result {
+                Ok(counts) => {
+                    total.add(&counts);
+                    if write_error.is_none() {
+                        if let Err(e) = out.write(
+                            &counts,
+                            options.selection,
+                            Some(paths[index].as_os_str()),
+                            false,
+                            None,
+                        ) {
+                            write_error = Some(e);
+                        }
+                    }
+                }
+                Err(e) => {
+                    let _ = writeln!(err, "wc-rs: {}: {e}", paths[index].display());
+                    ok = false;
+                }
+            },
+        );
+        if let Some(e) = write_error {
+            return Err(e);
+        }
+    } else {
+        let mut buf = vec![0u8; BUF_SIZE];
+        for input in &options.inputs {
+            if let (true, Input::Path(path)) = (options.index, input) {
+                match count_path_indexed(path, options.selection, options.io_options(), &mut buf) {
+                    Ok(counts) => {
+                        total.add(&counts);
+                        out.write(
+                            &counts,
+                            options.selection,
+                            Some(path.as_os_str()),
+                            false,
+                            None,
+                        )?;
+                    }
+                    Err(e) => {
+                        let _ = writeln!(err, "wc-rs: {}: {e}", path.display());
+                        ok = false;
+                    }
+                }
+                continue;
+            }
+            if let (Some(confidence), Input::Path(path)) = (options.estimate, input) {
+                match estimate_input(
+                    path,
+                    options.selection,
+                    confidence,
+                    options.io_options(),
+                    &mut buf,
+                ) {
+                    Ok((counts, mark)) => {
+                        total.add(&counts);
+                        if let Some((moe, _)) = mark {
+                            estimated = Some(estimated.map_or(moe, |m: f64| m.max(moe)));
+                        }
+                        out.write(
+                            &counts,
+                            options.selection,
+                            Some(path.as_os_str()),
+                            false,
+                            mark,
+                        )?;
+                    }
+                    Err(e) => {
+                        let _ = writeln!(err, "wc-rs: {}: {e}", path.display());
+                        ok = false;
+                    }
+                }
+                continue;
+            }
+            #[cfg(unix)]
+            if let (Some(cache), Input::Path(path)) = (cache.as_mut(), input) {
+                match count_path_cached(
+                    path,
+                    options.selection,
+                    options.io_options(),
+                    cache,
+                    &mut buf,
+                ) {
+                    Ok(counts) => {
+                        total.add(&counts);
+                        out.write(
+                            &counts,
+                            options.selection,
+                            Some(path.as_os_str()),
+                            false,
+                            None,
+                        )?;
+                    }
+                    Err(e) => {
+                        let _ = writeln!(err, "wc-rs: {}: {e}", path.display());
+                        ok = false;
+                    }
+                }
+                continue;
+            }
+            match count_input(input, options.selection, options.io_options(), &mut buf) {
+                Ok(counts) => {
+                    total.add(&counts);
+                    out.write(
+                        &counts,
+                        options.selection,
+                        input.display_name(),
+                        false,
+                        None,
+                    )?;
+                }
+                Err(e) => {
+                    let name = input.display_name().unwrap_or(OsStr::new("-"));
+                    let _ = writeln!(err, "wc-rs: {}: {e}", Path::new(name).display());
+                    ok = false;
+                }
+            }
+        }
+    }
+
+    if options.inputs.len() > 1 {
+        let mark = estimated.map(|moe| (moe, options.estimate.unwrap_or(0.95)));
+        out.write(&total, options.selection, None, true, mark)?;
+    }
+    out.flush()?;
+    #[cfg(unix)]
+    if let Some(cache) = cache {
+        if let Err(e) = cache.save() {
+            let _ = writeln!(err, "wc-rs: failed to write cache: {e}");
+        }
+    }
+    Ok(ok)
+}
+
+/// Downstream consumers (`wc-rs ... | head`) closing the pipe early is
+/// normal; exit quietly instead of panicking or reporting an error.
+fn exit_code_for(e: &io::Error) -> Option<ExitCode> {
+    (e.kind() == io::ErrorKind::BrokenPipe).then_some(ExitCode::SUCCESS)
+}
+
+/// Runs one full invocation with explicit output sinks; this is the entry
+/// the daemon reuses to serve remote argv with captured stdout/stderr.
+fn execute(args: impl Iterator<Item = OsString>, out: &mut dyn Write, err: &mut dyn Write) -> u8 {
+    let options = match parse_args(args) {
+        Ok(options) => options,
+        Err(msg) if msg == "help" => {
+            let _ = writeln!(out, "{}", usage());
+            return 0;
+        }
+        Err(msg) if msg == "version" => {
+            let _ = writeln!(out, "wc-rs {}", env!("CARGO_PKG_VERSION"));
+            return 0;
+        }
+        Err(msg) => {
+            let _ = writeln!(err, "wc-rs: {msg}");
+            let _ = writeln!(err, "Try 'wc-rs --help' for more information.");
+            return 1;
+        }
+    };
+
+    if options.stats {
+        stats::enable();
+    }
+    let start = std::time::Instant::now();
+    let outcome = match &options.files0_from {
+        Some(source) => run_files0(&options, source, &mut *out, err),
+        None => run(&options, &mut *out, err),
+    };
+    if options.stats {
+        let _ = writeln!(
+            err,
+            "{}",
+            stats::report(
+                start.elapsed(),
+                wc::kernel::kernel_name(),
+                BUF_SIZE,
+                options.threads
+            )
+        );
+    }
+    match outcome {
+        Ok(true) => 0,
+        Ok(false) => 1,
+        Err(e) => {
+            if exit_code_for(&e).is_some() {
+                return 0; // broken pipe: quiet success
+            }
+            let _ = writeln!(err, "wc-rs: {e}");
+            1
+        }
+    }
+}
+
+/// Splits daemon/client meta-flags off the front of argv before normal
+/// parsing; they change how the whole invocation is executed. The String
+/// wire protocol means daemon/client argv must be UTF-8; local execution
+/// has no such limit.
+#[cfg(unix)]
+fn daemon_mode(args: &[OsString]) -> Option<(bool, PathBuf, Result<Vec<String>, String>)> {
+    let first = args.first()?.to_str()?;
+    for (flag, is_daemon) in [("--daemon", true), ("--client", false)] {
+        let socket = if first == flag {
+            Some(daemon::default_socket())
+        } else {
+            first.strip_prefix(&format!("{flag}=")).map(PathBuf::from)
+        };
+        if let Some(socket) = socket {
+            let rest: Result<Vec<String>, String> = args[1..]
+                .iter()
+                .map(|arg| {
+                    arg.to_str().map(str::to_owned).ok_or_else(|| {
+                        format!("non-UTF-8 argument cannot cross the {flag} protocol")
+                    })
+                })
+                .collect();
+            return Some((is_daemon, socket, rest));
+        }
+    }
+    None
+}
+
+fn main() -> ExitCode {
+    let args: Vec<OsString> = std::env::args_os().skip(1).collect();
+
+    #[cfg(unix)]
+    if let Some((is_daemon, socket, rest)) = daemon_mode(&args) {
+        let rest = match rest {
+            Ok(rest) => rest,
+            Err(msg) => {
+                eprintln!("wc-rs: {msg}");
+                return ExitCode::FAILURE;
+            }
+        };
+        if is_daemon {
+            return match daemon::serve(&socket, |argv, out, err| {
+                execute(argv.into_iter().map(OsString::from), out, err)
+            }) {
+                Ok(()) => ExitCode::SUCCESS,
+                Err(e) => {
+                    eprintln!("wc-rs: daemon: {e}");
+                    ExitCode::FAILURE
+                }
+            };
+        }
+        // Client: forward to the daemon, or count locally when none answers.
+        // Invocations that read stdin never leave this process — forwarded,
+        // they would block on the daemon's stdin forever.
+        if daemon::requires_stdin(&rest).is_none() {
+            match daemon::request(&socket, &rest) {
+                Ok(0) => return ExitCode::SUCCESS,
+                Ok(_) => return ExitCode::FAILURE,
+                Err(_) => {} // no daemon; fall through to local execution
+            }
+        }
+        let code = execute(
+            rest.into_iter().map(OsString::from),
+            &mut io::stdout().lock(),
+            &mut io::stderr().lock(),
+        );
+        return if code == 0 {
+            ExitCode::SUCCESS
+        } else {
+            ExitCode::FAILURE
+        };
+    }
+
+    let code = execute(
+        args.into_iter(),
+        &mut io::stdout().lock(),
+        &mut io::stderr().lock(),
+    );
+    if code == 0 {
+        ExitCode::SUCCESS
+    } else {
+        ExitCode::FAILURE
+    }
+}
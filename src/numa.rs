@@ -0,0 +1,182 @@
+//! NUMA-aware placement for the parallel engine (Linux, `--numa`).
+//!
+//! On multi-socket hosts a naive pool loses to cross-node traffic: a
+//! worker on socket 1 counting a buffer that faulted in on socket 0 pays
+//! remote latency on every cache line. With `--numa` the parallel
+//! single-file engine switches from a shared mapping to positional reads:
+//! each worker is pinned to the CPUs of its assigned node (round-robin
+//! over the nodes sysfs reports), allocates and first-touches its own
+//! chunk buffer — which lands it in node-local memory — and aggregates
+//! partials locally; the in-order word-boundary merge at the end is the
+//! same one the flat parallel engine uses. Hosts with a single node fall
+//! through to the normal engines untouched.
+
+use std::fs::File;
+use std::io;
+use std::os::unix::fs::FileExt;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::Mutex;
+
+use crate::counts::{word_boundary, Counter, Counts, Selection, WordBoundary};
+use crate::parallel;
+
+/// Per-claim chunk; large enough that pinning and claim overhead vanish.
+const CHUNK: u64 = 64 * 1024 * 1024;
+
+/// CPU lists per NUMA node, parsed from sysfs. Empty or single-entry means
+/// NUMA placement has nothing to win.
+pub fn nodes() -> Vec<Vec<usize>> {
+    let mut nodes = Vec::new();
+    let Ok(entries) = std::fs::read_dir("/sys/devices/system/node") else {
+        return nodes;
+    };
+    let mut names: Vec<String> = entries
+        .filter_map(|e| e.ok())
+        .map(|e| e.file_name().to_string_lossy().into_owned())
+        .filter(|name| name.starts_with("node") && name[4..].chars().all(|c| c.is_ascii_digit()))
+        .collect();
+    names.sort();
+    for name in names {
+        let path = format!("/sys/devices/system/node/{name}/cpulist");
+        if let Ok(list) = std::fs::read_to_string(path) {
+            let cpus = parse_cpulist(list.trim());
+            if !cpus.is_empty() {
+                nodes.push(cpus);
+            }
+        }
+    }
+    nodes
+}
+
+/// Parses the kernel's cpulist format: `0-3,8,10-11`.
+fn parse_cpulist(list: &str) -> Vec<usize> {
+    let mut cpus = Vec::new();
+    for part in list.split(',').filter(|p| !p.is_empty()) {
+        match part.split_once('-') {
+            Some((lo, hi)) => {
+                if let (Ok(lo), Ok(hi)) = (lo.parse::<usize>(), hi.parse::<usize>()) {
+                    cpus.extend(lo..=hi);
+                }
+            }
+            None => {
+                if let Ok(cpu) = part.parse::<usize>() {
+                    cpus.push(cpu);
+                }
+            }
+        }
+    }
+    cpus
+}
+
+/// Pins the calling thread to `cpus`; best-effort, advisory.
+fn pin_to_cpus(cpus: &[usize]) {
+    unsafe {
+        let mut set: libc::cpu_set_t = std::mem::zeroed();
+        libc::CPU_ZERO(&mut set);
+        for &cpu in cpus {
+            if cpu < libc::CPU_SETSIZE as usize {
+                libc::CPU_SET(cpu, &mut set);
+            }
+        }
+        libc::sched_setaffinity(0, std::mem::size_of::<libc::cpu_set_t>(), &set);
+    }
+}
+
+/// Counts a large regular file with node-pinned workers and node-local
+/// buffers. Returns `None` on hosts where placement cannot matter (fewer
+/// than two NUMA nodes), letting the caller use the flat engines.
+pub fn count_file_numa(
+    file: &File,
+    len: u64,
+    selection: Selection,
+    threads: usize,
+) -> io::Result<Option<Counts>> {
+    let nodes = nodes();
+    if nodes.len() < 2 {
+        return Ok(None);
+    }
+
+    let next = AtomicU64::new(0);
+    let partials: Mutex<Vec<(u64, Counts, bool, WordBoundary)>> = Mutex::new(Vec::new());
+    let error: Mutex<Option<io::Error>> = Mutex::new(None);
+
+    std::thread::scope(|scope| {
+        for worker in 0..threads.max(nodes.len()) {
+            let node = &nodes[worker % nodes.len()];
+            let next = &next;
+            let partials = &partials;
+            let error = &error;
+            scope.spawn(move || {
+                pin_to_cpus(node);
+                // Allocated and first written by this pinned thread, so the
+                // pages land on this worker's node.
+                let mut buf = vec![0u8; CHUNK as usize];
+                let mut local: Vec<(u64, Counts, bool, WordBoundary)> = Vec::new();
+                loop {
+                    let offset = next.fetch_add(CHUNK, Ordering::Relaxed);
+                    if offset >= len {
+                        break;
+                    }
+                    let want = CHUNK.min(len - offset) as usize;
+                    let mut filled = 0;
+                    while filled < want {
+                        match file.read_at(&mut buf[filled..want], offset + filled as u64) {
+                            Ok(0) => break,
+                            Ok(n) => filled += n,
+                            Err(e) if e.kind() == io::ErrorKind::Interrupted => {}
+                            Err(e) => {
+                                *error.lock().unwrap() = Some(e);
+                                return;
+                            }
+                        }
+                    }
+                    let chunk = &buf[..filled];
+                    let mut counter = Counter::new(selection);
+                    counter.feed(chunk);
+                    let ends_in_word = counter.ends_in_word();
+                    local.push((offset, counter.finish(), ends_in_word, word_boundary(chunk)));
+                    if filled < want {
+                        break; // truncated under us
+                    }
+                }
+                // Per-node partial aggregation: one lock per worker, not
+                // per chunk.
+                partials.lock().unwrap().extend(local);
+            });
+        }
+    });
+
+    if let Some(e) = error.into_inner().unwrap() {
+        return Err(e);
+    }
+    let mut partials = partials.into_inner().unwrap();
+    partials.sort_by_key(|(offset, ..)| *offset);
+    let ordered: Vec<(Counts, bool, WordBoundary)> = partials
+        .into_iter()
+        .map(|(_, counts, in_word, boundary)| (counts, in_word, boundary))
+        .collect();
+    Ok(Some(parallel::merge_partials(&ordered, selection)))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn cpulist_parsing() {
+        assert_eq!(parse_cpulist("0-3,8,10-11"), vec![0, 1, 2, 3, 8, 10, 11]);
+        assert_eq!(parse_cpulist("0"), vec![0]);
+        assert_eq!(parse_cpulist(""), Vec::<usize>::new());
+    }
+
+    #[test]
+    fn single_node_host_declines() {
+        // This only asserts the graceful path on whatever host runs the
+        // suite; multi-node behavior needs multi-node hardware.
+        if nodes().len() < 2 {
+            let file = File::open("/proc/self/exe").unwrap();
+            let result = count_file_numa(&file, 1024, Selection::default_counters(), 4).unwrap();
+            assert!(result.is_none());
+        }
+    }
+}
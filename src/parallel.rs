@@ -0,0 +1,182 @@
+//! Parallel counting over a single in-memory slice.
+//!
+//! A large mapped file is split into contiguous chunks, each counted on its
+//! own thread with the same `Counter` the serial path uses, and the partial
+//! results are merged in order. The only cross-chunk state is whether a word
+//! straddles a chunk edge: a chunk that ends mid-word and a successor whose
+//! first word starts before any separator have counted one word twice, so
+//! the merge subtracts it (`WordBoundary` tracks the neutral-byte case where
+//! word state passes through a chunk untouched).
+//!
+//! `-L` is excluded: tab stops make a line's display width depend on its
+//! absolute start column, so line widths cannot be computed chunk-locally.
+//! Selections that include it take the serial engine instead.
+
+use crate::counts::{word_boundary, Counter, Counts, Selection, WordBoundary};
+
+/// Slices below this size stay serial; thread startup and merge overhead
+/// would swamp the counting.
+pub const PARALLEL_THRESHOLD: u64 = 8 * 1024 * 1024;
+
+/// Whether the parallel engine applies to this selection. Custom word
+/// delimiters disable it because the chunk-boundary stitching classifies
+/// bytes with the standard whitespace rule.
+pub fn supports(selection: Selection) -> bool {
+    !(selection.max_line_length || selection.words && crate::counts::custom_word_delims_active())
+}
+
+/// Counts `data` across `threads` chunks. Falls back to a single serial pass
+/// when the slice is too small to be worth splitting.
+pub fn count_slice(data: &[u8], selection: Selection, threads: usize) -> Counts {
+    debug_assert!(supports(selection));
+    let chunk_size = data.len().div_ceil(threads.max(1));
+    count_slice_chunked(data, selection, chunk_size)
+}
+
+/// The worker split, parameterized by chunk size so tests can force word
+/// and UTF-8 sequences onto every boundary.
+fn count_slice_chunked(data: &[u8], selection: Selection, chunk_size: usize) -> Counts {
+    if chunk_size == 0 || chunk_size >= data.len() {
+        let mut counter = Counter::new(selection);
+        counter.feed(data);
+        return counter.finish();
+    }
+
+    let chunks: Vec<&[u8]> = data.chunks(chunk_size).collect();
+    let mut partials: Vec<(Counts, bool, WordBoundary)> = Vec::with_capacity(chunks.len());
+
+    std::thread::scope(|scope| {
+        let handles: Vec<_> = chunks
+            .iter()
+            .map(|chunk| {
+                scope.spawn(move || {
+                    let mut counter = Counter::new(selection);
+                    counter.feed(chunk);
+                    let ends_in_word = counter.ends_in_word();
+                    (counter.finish(), ends_in_word, word_boundary(chunk))
+                })
+            })
+            .collect();
+        for handle in handles {
+            partials.push(handle.join().expect("counting worker panicked"));
+        }
+    });
+
+    merge_partials(&partials, selection)
+}
+
+/// Merges in-order chunk partials, deduplicating words that straddle
+/// chunk edges; shared with the NUMA engine, which produces the same
+/// partial shape from node-pinned workers.
+pub(crate) fn merge_partials(
+    partials: &[(Counts, bool, WordBoundary)],
+    selection: Selection,
+) -> Counts {
+    let mut total = Counts::default();
+    let mut carry_in_word = false;
+    for (counts, ends_in_word, boundary) in partials {
+        total.add(counts);
+        // Only adjust when words were actually counted: `finish` zeroes the
+        // field for unselected counters, so subtracting would underflow.
+        if selection.words && carry_in_word && *boundary == WordBoundary::StartsWord {
+            // The word straddling the edge was counted by both sides.
+            total.words -= 1;
+        }
+        if *boundary != WordBoundary::AllNeutral {
+            carry_in_word = *ends_in_word;
+        }
+    }
+    total
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn all_but_max_line() -> Selection {
+        Selection {
+            lines: true,
+            words: true,
+            bytes: true,
+            chars: true,
+            max_line_length: false,
+        }
+    }
+
+    fn serial(data: &[u8]) -> Counts {
+        let mut counter = Counter::new(all_but_max_line());
+        counter.feed(data);
+        counter.finish()
+    }
+
+    fn assert_parity_at_every_chunk_size(data: &[u8]) {
+        let expected = serial(data);
+        for chunk_size in 1..=data.len().min(64) {
+            assert_eq!(
+                count_slice_chunked(data, all_but_max_line(), chunk_size),
+                expected,
+                "chunk_size={chunk_size}"
+            );
+        }
+    }
+
+    #[test]
+    fn words_straddling_every_boundary() {
+        assert_parity_at_every_chunk_size(b"alpha beta gamma delta epsilon zeta");
+    }
+
+    #[test]
+    fn newlines_and_multiple_spaces() {
+        assert_parity_at_every_chunk_size(b"  one\n\ntwo  three \n four\n");
+    }
+
+    #[test]
+    fn neutral_bytes_carry_word_state() {
+        // 0x01 is non-printable and non-space: it must neither end the
+        // straddling word nor start a new one, at any split point.
+        assert_parity_at_every_chunk_size(b"ab\x01\x01\x01cd ef\x01 \x01gh");
+    }
+
+    #[test]
+    fn utf8_sequences_across_boundaries() {
+        assert_parity_at_every_chunk_size("héllo wörld ünïcode 日本語\n".as_bytes());
+    }
+
+    #[test]
+    fn chars_only_selection_does_not_underflow_words() {
+        // Words are tracked internally by the scalar loop but zeroed by
+        // `finish` when unselected; the merge must not adjust them then.
+        let selection = Selection {
+            chars: true,
+            ..Selection::default()
+        };
+        let data = b"word straddles every boundary here";
+        for chunk_size in 1..=data.len() {
+            let counts = count_slice_chunked(data, selection, chunk_size);
+            assert_eq!(counts.words, 0, "chunk_size={chunk_size}");
+            assert_eq!(counts.chars, data.len() as u64);
+        }
+    }
+
+    #[test]
+    fn empty_and_tiny_inputs() {
+        assert_eq!(count_slice(b"", all_but_max_line(), 4), serial(b""));
+        assert_eq!(count_slice(b"x", all_but_max_line(), 4), serial(b"x"));
+    }
+
+    #[test]
+    fn thread_split_matches_serial_on_large_input() {
+        let mut data = Vec::new();
+        while data.len() < 1 << 20 {
+            data.extend_from_slice(
+                b"some words here\nand a few more on this line\n\x01odd\x01bytes ",
+            );
+        }
+        for threads in [1, 2, 3, 8] {
+            assert_eq!(
+                count_slice(&data, all_but_max_line(), threads),
+                serial(&data)
+            );
+        }
+    }
+}
@@ -0,0 +1,447 @@
+//! Remote counting over HTTP range requests (`http://` operands).
+//!
+//! Object-store corpora should not be staged to scratch disk just to be
+//! counted. A URL operand is counted straight off the wire: a probe
+//! request learns the object's length, then worker connections claim
+//! 8 MiB ranges with concurrent GETs — the multithreaded chunk engine
+//! with HTTP as the I/O layer — and the partials merge with the same
+//! word-boundary stitching the local parallel engine uses. Selections the
+//! chunk merge cannot express (-L, custom word delimiters) stream the
+//! object through a single sequential GET instead.
+//!
+//! The client is a deliberately small HTTP/1.1 implementation over
+//! `TcpStream`: range GETs against S3-compatible stores need nothing
+//! more. Plain `http://` only — in-cluster object endpoints are typically
+//! unencrypted behind the VPC, and TLS belongs to a terminating proxy
+//! rather than a hand-rolled client.
+
+use std::io::{self, Read, Write};
+use std::net::TcpStream;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::Mutex;
+
+use crate::counts::{word_boundary, Counter, Counts, Selection, WordBoundary};
+use crate::parallel;
+use crate::stream;
+
+/// Range size per request; big enough to amortize request latency, small
+/// enough to keep many in flight.
+const RANGE: u64 = 8 * 1024 * 1024;
+/// Concurrent connections for ranged counting.
+const CONNECTIONS: usize = 8;
+
+struct Url<'a> {
+    host: &'a str,
+    port: u16,
+    path: &'a str,
+    host_header: &'a str,
+}
+
+fn parse_url(url: &str) -> io::Result<Url<'_>> {
+    let rest = url
+        .strip_prefix("http://")
+        .ok_or_else(|| io::Error::other("only http:// URLs are supported"))?;
+    let (authority, path) = match rest.find('/') {
+        Some(i) => (&rest[..i], &rest[i..]),
+        None => (rest, "/"),
+    };
+    let (host, port) = match authority.rsplit_once(':') {
+        Some((host, port)) => (
+            host,
+            port.parse::<u16>()
+                .map_err(|_| io::Error::other(format!("invalid port in '{url}'")))?,
+        ),
+        None => (authority, 80),
+    };
+    Ok(Url {
+        host,
+        port,
+        path,
+        host_header: authority,
+    })
+}
+
+struct Response {
+    status: u16,
+    /// Absent when the server sent no Content-Length (e.g. chunked).
+    content_length: Option<u64>,
+    content_range_total: Option<u64>,
+    chunked: bool,
+}
+
+/// Sends one GET (optionally ranged) and parses the response head; the body
+/// is then read from `stream`. `close` requests Connection: close so a
+/// length-less response can be read to EOF.
+fn send_get(
+    stream: &mut TcpStream,
+    url: &Url,
+    range: Option<(u64, u64)>,
+    close: bool,
+) -> io::Result<Response> {
+    let connection = if close { "close" } else { "keep-alive" };
+    let mut request = format!(
+        "GET {} HTTP/1.1\r\nHost: {}\r\nUser-Agent: wc-rs\r\nConnection: {connection}\r\n",
+        url.path, url.host_header
+    );
+    if let Some((start, end)) = range {
+        request.push_str(&format!("Range: bytes={start}-{end}\r\n"));
+    }
+    request.push_str("\r\n");
+    stream.write_all(request.as_bytes())?;
+
+    // Read the header block byte-by-byte (it is tiny next to the body).
+    let mut head = Vec::with_capacity(512);
+    let mut byte = [0u8; 1];
+    while !head.ends_with(b"\r\n\r\n") {
+        match stream.read(&mut byte)? {
+            0 => return Err(io::Error::other("connection closed in response headers")),
+            _ => head.push(byte[0]),
+        }
+        if head.len() > 64 * 1024 {
+            return Err(io::Error::other("oversized response headers"));
+        }
+    }
+    let head = String::from_utf8_lossy(&head);
+    let mut lines = head.lines();
+    let status = lines
+        .next()
+        .and_then(|line| line.split_whitespace().nth(1))
+        .and_then(|code| code.parse::<u16>().ok())
+        .ok_or_else(|| io::Error::other("malformed status line"))?;
+    let mut content_length = None;
+    let mut content_range_total = None;
+    let mut chunked = false;
+    for line in lines {
+        let Some((name, value)) = line.split_once(':') else {
+            continue;
+        };
+        let value = value.trim();
+        if name.eq_ignore_ascii_case("content-length") {
+            content_length = Some(
+                value
+                    .parse()
+                    .map_err(|_| io::Error::other("bad Content-Length"))?,
+            );
+        } else if name.eq_ignore_ascii_case("content-range") {
+            // "bytes 0-0/12345"
+            content_range_total = value.rsplit_once('/').and_then(|(_, t)| t.parse().ok());
+        } else if name.eq_ignore_ascii_case("transfer-encoding")
+            && value.to_ascii_lowercase().contains("chunked")
+        {
+            chunked = true;
+        }
+    }
+    Ok(Response {
+        status,
+        content_length,
+        content_range_total,
+        chunked,
+    })
+}
+
+fn read_body(stream: &mut TcpStream, len: u64, mut sink: impl FnMut(&[u8])) -> io::Result<()> {
+    let mut remaining = len;
+    let mut buf = vec![0u8; 256 * 1024];
+    while remaining > 0 {
+        let want = buf.len().min(remaining as usize);
+        match stream.read(&mut buf[..want]) {
+            Ok(0) => return Err(io::Error::other("connection closed mid-body")),
+            Ok(n) => {
+                sink(&buf[..n]);
+                remaining -= n as u64;
+            }
+            Err(e) if e.kind() == io::ErrorKind::Interrupted => {}
+            Err(e) => return Err(e),
+        }
+    }
+    Ok(())
+}
+
+/// Learns the object length with a 1-byte range probe (HEAD is optional on
+/// some stores; a ranged GET is not).
+fn probe_length(url: &Url) -> io::Result<Option<u64>> {
+    let mut stream = TcpStream::connect((url.host, url.port))?;
+    let response = send_get(&mut stream, url, Some((0, 0)), false)?;
+    match response.status {
+        206 => {
+            // Drain the probe byte so the connection could be reused.
+            read_body(&mut stream, response.content_length.unwrap_or(0), |_| {})?;
+            Ok(response.content_range_total)
+        }
+        200 => Ok(None), // server ignores ranges; caller streams instead
+        status => Err(io::Error::other(format!(
+            "range probe failed with HTTP {status}"
+        ))),
+    }
+}
+
+/// Counts one URL operand.
+pub fn count_url(url_str: &str, selection: Selection, threads: usize) -> io::Result<Counts> {
+    let url = parse_url(url_str)?;
+    let ranged_len = probe_length(&url)?;
+
+    let use_chunks = parallel::supports(selection);
+    match ranged_len {
+        Some(len) if use_chunks && len > 0 => count_ranged(&url, len, selection, threads),
+        _ => count_streamed(&url, selection),
+    }
+}
+
+/// Sequential fallback: one GET, counted through the overlapped pipeline.
+/// Requests Connection: close so a server that sends no Content-Length can
+/// still be counted to EOF; chunked framing is not parsed and fails loudly
+/// rather than silently reporting zero.
+fn count_streamed(url: &Url, selection: Selection) -> io::Result<Counts> {
+    let mut stream = TcpStream::connect((url.host, url.port))?;
+    let response = send_get(&mut stream, url, None, true)?;
+    if response.status != 200 {
+        return Err(io::Error::other(format!("HTTP {}", response.status)));
+    }
+    if response.chunked {
+        return Err(io::Error::other(
+            "chunked transfer encoding is not supported; serve the object \
+             with a Content-Length",
+        ));
+    }
+    match response.content_length {
+        Some(len) => {
+            let mut body = stream.take(len);
+            stream::count_reader_overlapped(&mut body, selection)
+        }
+        // No length and Connection: close: the body runs to EOF.
+        None => stream::count_reader_overlapped(&mut stream, selection),
+    }
+}
+
+/// Ranged engine: workers claim 8 MiB ranges over persistent connections;
+/// chunk partials merge in offset order with word-boundary stitching.
+fn count_ranged(url: &Url, len: u64, selection: Selection, threads: usize) -> io::Result<Counts> {
+    let connections = CONNECTIONS.min(threads.max(2)).max(2);
+    let next = AtomicU64::new(0);
+    let partials: Mutex<Vec<(u64, Counts, bool, WordBoundary)>> = Mutex::new(Vec::new());
+    let error: Mutex<Option<io::Error>> = Mutex::new(None);
+
+    std::thread::scope(|scope| {
+        for _ in 0..connections {
+            let next = &next;
+            let partials = &partials;
+            let error = &error;
+            scope.spawn(move || {
+                let mut conn: Option<TcpStream> = None;
+                let mut local = Vec::new();
+                loop {
+                    let offset = next.fetch_add(RANGE, Ordering::Relaxed);
+                    if offset >= len || error.lock().unwrap().is_some() {
+                        break;
+                    }
+                    let end = (offset + RANGE - 1).min(len - 1);
+                    let result = (|| -> io::Result<()> {
+                        let stream = match conn.as_mut() {
+                            Some(stream) => stream,
+                            None => conn.insert(TcpStream::connect((url.host, url.port))?),
+                        };
+                        let response = send_get(stream, url, Some((offset, end)), false)?;
+                        if response.status != 206 {
+                            return Err(io::Error::other(format!(
+                                "range request failed with HTTP {}",
+                                response.status
+                            )));
+                        }
+                        let Some(content_length) = response.content_length else {
+                            return Err(io::Error::other("range response without Content-Length"));
+                        };
+                        let mut counter = Counter::new(selection);
+                        // Capture leading bytes until their boundary class
+                        // is decided (one byte on text; longer only for a
+                        // neutral-byte run at the range edge).
+                        let mut lead: Vec<u8> = Vec::new();
+                        let mut lead_decided = false;
+                        read_body(stream, content_length, |chunk| {
+                            if !lead_decided {
+                                for &b in chunk {
+                                    // Earlier bytes are all neutral, so the
+                                    // class of the first non-neutral byte
+                                    // decides; cap the capture so a fully
+                                    // neutral (binary) range stays cheap.
+                                    lead.push(b);
+                                    if word_boundary(&[b]) != WordBoundary::AllNeutral
+                                        || lead.len() >= 4096
+                                    {
+                                        lead_decided = true;
+                                        break;
+                                    }
+                                }
+                            }
+                            counter.feed(chunk);
+                        })?;
+                        let ends_in_word = counter.ends_in_word();
+                        local.push((offset, counter.finish(), ends_in_word, word_boundary(&lead)));
+                        Ok(())
+                    })();
+                    if let Err(e) = result {
+                        *error.lock().unwrap() = Some(e);
+                        break;
+                    }
+                }
+                partials.lock().unwrap().extend(local);
+            });
+        }
+    });
+
+    if let Some(e) = error.into_inner().unwrap() {
+        return Err(e);
+    }
+    let mut partials = partials.into_inner().unwrap();
+    partials.sort_by_key(|(offset, ..)| *offset);
+    let ordered: Vec<(Counts, bool, WordBoundary)> = partials
+        .into_iter()
+        .map(|(_, counts, in_word, boundary)| (counts, in_word, boundary))
+        .collect();
+    Ok(parallel::merge_partials(&ordered, selection))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::net::TcpListener;
+
+    /// Minimal in-process range server over a fixed body.
+    fn serve(body: &'static [u8]) -> String {
+        let listener = TcpListener::bind("127.0.0.1:0").unwrap();
+        let addr = listener.local_addr().unwrap();
+        std::thread::spawn(move || {
+            for stream in listener.incoming() {
+                let Ok(mut stream) = stream else { break };
+                std::thread::spawn(move || loop {
+                    let mut head = Vec::new();
+                    let mut byte = [0u8; 1];
+                    while !head.ends_with(b"\r\n\r\n") {
+                        match stream.read(&mut byte) {
+                            Ok(0) | Err(_) => return,
+                            Ok(_) => head.push(byte[0]),
+                        }
+                    }
+                    let head = String::from_utf8_lossy(&head);
+                    let range = head.lines().find_map(|line| {
+                        line.to_ascii_lowercase()
+                            .strip_prefix("range: bytes=")
+                            .map(str::to_owned)
+                    });
+                    let response = match range {
+                        Some(spec) => {
+                            let (start, end) = spec.trim().split_once('-').unwrap();
+                            let start: usize = start.parse().unwrap();
+                            let end: usize = end.parse::<usize>().unwrap().min(body.len() - 1);
+                            let slice = &body[start..=end];
+                            let mut r = format!(
+                                "HTTP/1.1 206 Partial Content\r\nContent-Length: {}\r\nContent-Range: bytes {start}-{end}/{}\r\n\r\n",
+                                slice.len(),
+                                body.len()
+                            )
+                            .into_bytes();
+                            r.extend_from_slice(slice);
+                            r
+                        }
+                        None => {
+                            let mut r = format!(
+                                "HTTP/1.1 200 OK\r\nContent-Length: {}\r\n\r\n",
+                                body.len()
+                            )
+                            .into_bytes();
+                            r.extend_from_slice(body);
+                            r
+                        }
+                    };
+                    if stream.write_all(&response).is_err() {
+                        return;
+                    }
+                });
+            }
+        });
+        format!("http://{addr}/object")
+    }
+
+    fn expected(body: &[u8], selection: Selection) -> Counts {
+        let mut counter = Counter::new(selection);
+        counter.feed(body);
+        counter.finish()
+    }
+
+    static BODY: &[u8] = b"remote words split across ranges\nand lines too\nplus a tail";
+
+    #[test]
+    fn ranged_counting_matches_local() {
+        let url = serve(BODY);
+        let selection = Selection::default_counters();
+        let counts = count_url(&url, selection, 4).unwrap();
+        assert_eq!(counts, expected(BODY, selection));
+    }
+
+    #[test]
+    fn streamed_fallback_for_max_line_length() {
+        let url = serve(BODY);
+        let selection = Selection {
+            max_line_length: true,
+            lines: true,
+            ..Selection::default()
+        };
+        let counts = count_url(&url, selection, 4).unwrap();
+        assert_eq!(counts, expected(BODY, selection));
+    }
+
+    /// Serves one response with no Content-Length (close-delimited), or
+    /// chunked framing, regardless of the request.
+    fn serve_special(kind: &'static str) -> String {
+        let listener = TcpListener::bind("127.0.0.1:0").unwrap();
+        let addr = listener.local_addr().unwrap();
+        std::thread::spawn(move || {
+            for stream in listener.incoming() {
+                let Ok(mut stream) = stream else { break };
+                std::thread::spawn(move || {
+                    let mut head = Vec::new();
+                    let mut byte = [0u8; 1];
+                    while !head.ends_with(b"\r\n\r\n") {
+                        match stream.read(&mut byte) {
+                            Ok(0) | Err(_) => return,
+                            Ok(_) => head.push(byte[0]),
+                        }
+                    }
+                    let response: Vec<u8> = match kind {
+                        "no-length" => {
+                            let mut r = b"HTTP/1.1 200 OK\r\nConnection: close\r\n\r\n".to_vec();
+                            r.extend_from_slice(BODY);
+                            r
+                        }
+                        _ => b"HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n\
+                               b\r\nhello world\r\n0\r\n\r\n"
+                            .to_vec(),
+                    };
+                    let _ = stream.write_all(&response);
+                    // Close-delimited: dropping the stream ends the body.
+                });
+            }
+        });
+        format!("http://{addr}/object")
+    }
+
+    #[test]
+    fn no_content_length_reads_to_eof() {
+        let url = serve_special("no-length");
+        let selection = Selection::default_counters();
+        let counts = count_url(&url, selection, 1).unwrap();
+        assert_eq!(counts, expected(BODY, selection));
+    }
+
+    #[test]
+    fn chunked_responses_fail_loudly_not_zero() {
+        let url = serve_special("chunked");
+        let err = count_url(&url, Selection::default_counters(), 1).unwrap_err();
+        assert!(err.to_string().contains("chunked"), "{err}");
+    }
+
+    #[test]
+    fn https_and_garbage_urls_error_cleanly() {
+        assert!(count_url("https://host/x", Selection::default_counters(), 1).is_err());
+        assert!(count_url("http://127.0.0.1:1/none", Selection::default_counters(), 1).is_err());
+    }
+}
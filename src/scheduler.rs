@@ -0,0 +1,214 @@
+//! Parallel scheduler for many-file runs.
+//!
+//! With millions of small files the bottleneck is per-file syscall latency
+//! (open/stat/read/close), not CPU, so the win comes from keeping dozens of
+//! files in flight at once. Workers pull the next unclaimed index from a
+//! shared atomic counter, count the file with the usual single-file
+//! engines, and park the result in its slot of a reused completion table;
+//! the caller replays slots in input order as they fill. Output ordering
+//! is therefore identical to the serial loop no matter how counting
+//! interleaves, and the steady state of the file loop performs no heap
+//! allocation: slots, worker buffers, and the claim counter are all reused
+//! across the batch (errors still allocate their messages — they are the
+//! cold path).
+
+use std::io;
+use std::path::Path;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::{Condvar, Mutex};
+
+use crate::counts::{Counts, Selection};
+use crate::input::{self, IoOptions, BUF_SIZE};
+
+/// Upper bound on files in flight per scheduling round. Rounds cap the
+/// reorder buffer: one slow file early in the list cannot let workers race
+/// millions of results ahead of the emission cursor.
+const BATCH: usize = 4096;
+
+/// Counts `paths` on up to `threads` workers, invoking `emit` for each file
+/// in input order as its result becomes available.
+pub fn count_files(
+    paths: &[&Path],
+    selection: Selection,
+    opts: IoOptions,
+    mut emit: impl FnMut(usize, io::Result<Counts>),
+) {
+    let workers = opts.threads.min(paths.len());
+    if workers <= 1 {
+        let mut buf = vec![0u8; BUF_SIZE];
+        for (index, path) in paths.iter().enumerate() {
+            emit(index, count_one(path, selection, opts, &mut buf));
+        }
+        return;
+    }
+
+    // One completion table serves every batch; slots are cleared in place.
+    let mut slots: Vec<Option<io::Result<Counts>>> = Vec::with_capacity(BATCH.min(paths.len()));
+    for (batch_index, batch) in paths.chunks(BATCH).enumerate() {
+        let base = batch_index * BATCH;
+        count_batch(
+            batch,
+            selection,
+            workers,
+            opts,
+            &mut slots,
+            |index, result| emit(base + index, result),
+        );
+    }
+}
+
+fn count_batch(
+    paths: &[&Path],
+    selection: Selection,
+    workers: usize,
+    opts: IoOptions,
+    slots: &mut Vec<Option<io::Result<Counts>>>,
+    mut emit: impl FnMut(usize, io::Result<Counts>),
+) {
+    slots.clear();
+    slots.resize_with(paths.len(), || None);
+    let table = CompletionTable {
+        slots: Mutex::new(std::mem::take(slots)),
+        filled: Condvar::new(),
+    };
+    let next = AtomicUsize::new(0);
+
+    std::thread::scope(|scope| {
+        for _ in 0..workers {
+            let next = &next;
+            let table = &table;
+            scope.spawn(move || {
+                let mut buf = vec![0u8; BUF_SIZE];
+                loop {
+                    let index = next.fetch_add(1, Ordering::Relaxed);
+                    if index >= paths.len() {
+                        break;
+                    }
+                    let result = count_one(paths[index], selection, opts, &mut buf);
+                    let mut slots = table.slots.lock().unwrap();
+                    slots[index] = Some(result);
+                    drop(slots);
+                    table.filled.notify_all();
+                }
+            });
+        }
+
+        // Replay completions in input order, sleeping on the condvar while
+        // the next slot is still in flight.
+        let mut next_to_emit = 0;
+        let mut slots = table.slots.lock().unwrap();
+        while next_to_emit < paths.len() {
+            match slots[next_to_emit].take() {
+                Some(result) => {
+                    drop(slots);
+                    emit(next_to_emit, result);
+                    next_to_emit += 1;
+                    slots = table.slots.lock().unwrap();
+                }
+                None => {
+                    slots = table.filled.wait(slots).unwrap();
+                }
+            }
+        }
+    });
+
+    *slots = table.slots.into_inner().unwrap();
+}
+
+struct CompletionTable {
+    slots: Mutex<Vec<Option<io::Result<Counts>>>>,
+    filled: Condvar,
+}
+
+fn count_one(
+    path: &Path,
+    selection: Selection,
+    opts: IoOptions,
+    buf: &mut [u8],
+) -> io::Result<Counts> {
+    // Inner parallelism stays off: with many files in flight the threads are
+    // already busy, and nesting pools would oversubscribe.
+    input::count_file(
+        &mut input::open_input(path)?,
+        selection,
+        IoOptions { threads: 1, ..opts },
+        buf,
+    )
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::fs::File;
+    use std::io::Write;
+
+    fn temp_files(contents: &[&[u8]]) -> Vec<String> {
+        contents
+            .iter()
+            .enumerate()
+            .map(|(i, data)| {
+                let path =
+                    std::env::temp_dir().join(format!("wc-rs-sched-{}-{i}", std::process::id()));
+                let mut file = File::create(&path).unwrap();
+                file.write_all(data).unwrap();
+                path.to_str().unwrap().to_owned()
+            })
+            .collect()
+    }
+
+    #[test]
+    fn results_arrive_in_input_order() {
+        let paths = temp_files(&[
+            b"one\n",
+            b"two words\n",
+            b"three words here\n",
+            b"4 words on line 4\n... plus more\n",
+            b"",
+        ]);
+        let refs: Vec<&Path> = paths.iter().map(|p| Path::new(p.as_str())).collect();
+        for threads in [1, 2, 8] {
+            let mut seen = Vec::new();
+            count_files(
+                &refs,
+                Selection::default_counters(),
+                IoOptions {
+                    threads,
+                    ..IoOptions::default()
+                },
+                |i, r| {
+                    seen.push((i, r.unwrap().words));
+                },
+            );
+            assert_eq!(
+                seen,
+                vec![(0, 1), (1, 2), (2, 3), (3, 8), (4, 0)],
+                "threads={threads}"
+            );
+        }
+        for path in paths {
+            std::fs::remove_file(path).unwrap();
+        }
+    }
+
+    #[test]
+    fn errors_keep_their_slot() {
+        let mut paths = temp_files(&[b"a\n", b"b\n"]);
+        paths.insert(1, "/nonexistent/wc-rs-sched".to_owned());
+        let refs: Vec<&Path> = paths.iter().map(|p| Path::new(p.as_str())).collect();
+        let mut outcomes = Vec::new();
+        count_files(
+            &refs,
+            Selection::default_counters(),
+            IoOptions {
+                threads: 4,
+                ..IoOptions::default()
+            },
+            |i, r| {
+                outcomes.push((i, r.is_ok()));
+            },
+        );
+        assert_eq!(outcomes, vec![(0, true), (1, false), (2, true)]);
+        std::fs::remove_file(&paths[0]).unwrap();
+        std::fs::remove_file(&paths[2]).unwrap();
+    }
+}
@@ -0,0 +1,195 @@
+//! Hot-path instrumentation behind `--stats`.
+//!
+//! When enabled, the engines record coarse events — bytes fed to kernels,
+//! time blocked in reads vs time counting, read syscalls, which engine
+//! handled each file — into relaxed atomics, and the CLI prints one
+//! machine-readable `key=value` line to stderr on exit. Everything is
+//! per-buffer or per-file granularity, so the overhead is unmeasurable,
+//! and with `--stats` off the only cost is a relaxed load per event.
+
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::time::{Duration, Instant};
+
+static ENABLED: AtomicBool = AtomicBool::new(false);
+
+static BYTES: AtomicU64 = AtomicU64::new(0);
+static IO_WAIT_NS: AtomicU64 = AtomicU64::new(0);
+static COUNT_NS: AtomicU64 = AtomicU64::new(0);
+static READ_SYSCALLS: AtomicU64 = AtomicU64::new(0);
+
+static FILES_MMAP: AtomicU64 = AtomicU64::new(0);
+static FILES_PARALLEL: AtomicU64 = AtomicU64::new(0);
+static FILES_STREAM: AtomicU64 = AtomicU64::new(0);
+static FILES_FSTAT: AtomicU64 = AtomicU64::new(0);
+static FILES_URING: AtomicU64 = AtomicU64::new(0);
+static FILES_DECOMPRESSED: AtomicU64 = AtomicU64::new(0);
+static FILES_DIRECT: AtomicU64 = AtomicU64::new(0);
+static FILES_DIRECT_FALLBACK: AtomicU64 = AtomicU64::new(0);
+static CACHE_HITS: AtomicU64 = AtomicU64::new(0);
+static THP_KB: AtomicU64 = AtomicU64::new(0);
+static CACHE_MISSES: AtomicU64 = AtomicU64::new(0);
+
+/// Which engine served a file; one bump per file.
+#[derive(Clone, Copy)]
+pub enum Engine {
+    Mmap,
+    Parallel,
+    Stream,
+    Fstat,
+    Uring,
+    Decompressed,
+    Direct,
+    DirectFallback,
+}
+
+pub fn enable() {
+    ENABLED.store(true, Ordering::Relaxed);
+}
+
+#[inline]
+pub fn enabled() -> bool {
+    ENABLED.load(Ordering::Relaxed)
+}
+
+#[inline]
+pub fn add_bytes(n: u64) {
+    if enabled() {
+        BYTES.fetch_add(n, Ordering::Relaxed);
+    }
+}
+
+#[inline]
+pub fn add_read_syscall() {
+    if enabled() {
+        READ_SYSCALLS.fetch_add(1, Ordering::Relaxed);
+    }
+}
+
+pub fn add_io_wait(elapsed: Duration) {
+    IO_WAIT_NS.fetch_add(elapsed.as_nanos() as u64, Ordering::Relaxed);
+}
+
+pub fn add_count_time(elapsed: Duration) {
+    COUNT_NS.fetch_add(elapsed.as_nanos() as u64, Ordering::Relaxed);
+}
+
+/// Times `f` into the counting bucket when stats are on.
+pub fn timed_count<T>(f: impl FnOnce() -> T) -> T {
+    if !enabled() {
+        return f();
+    }
+    let start = Instant::now();
+    let value = f();
+    add_count_time(start.elapsed());
+    value
+}
+
+/// Times `f` into the I/O-wait bucket when stats are on.
+pub fn timed_io<T>(f: impl FnOnce() -> T) -> T {
+    if !enabled() {
+        return f();
+    }
+    let start = Instant::now();
+    let value = f();
+    add_io_wait(start.elapsed());
+    value
+}
+
+pub fn bump(engine: Engine) {
+    if !enabled() {
+        return;
+    }
+    let counter = match engine {
+        Engine::Mmap => &FILES_MMAP,
+        Engine::Parallel => &FILES_PARALLEL,
+        Engine::Stream => &FILES_STREAM,
+        Engine::Fstat => &FILES_FSTAT,
+        Engine::Uring => &FILES_URING,
+        Engine::Decompressed => &FILES_DECOMPRESSED,
+        Engine::Direct => &FILES_DIRECT,
+        Engine::DirectFallback => &FILES_DIRECT_FALLBACK,
+    };
+    counter.fetch_add(1, Ordering::Relaxed);
+}
+
+/// Records how much of a mapping the kernel actually backed with huge
+/// pages (--hugepages; from /proc/self/smaps).
+pub fn set_thp_kb(kb: u64) {
+    if enabled() {
+        THP_KB.fetch_max(kb, Ordering::Relaxed);
+    }
+}
+
+pub fn cache_hit() {
+    if enabled() {
+        CACHE_HITS.fetch_add(1, Ordering::Relaxed);
+    }
+}
+
+pub fn cache_miss() {
+    if enabled() {
+        CACHE_MISSES.fetch_add(1, Ordering::Relaxed);
+    }
+}
+
+/// One machine-readable line summarizing the run.
+pub fn report(wall: Duration, kernel: &str, buf_size: usize, threads: usize) -> String {
+    let bytes = BYTES.load(Ordering::Relaxed);
+    let wall_s = wall.as_secs_f64();
+    let gbps = if wall_s > 0.0 {
+        bytes as f64 / 1e9 / wall_s
+    } else {
+        0.0
+    };
+    format!(
+        "wc-rs-stats: bytes={bytes} wall_ms={:.1} io_wait_ms={:.1} count_ms={:.1} \
+         gbps={gbps:.2} read_syscalls={} files_mmap={} files_parallel={} files_stream={} \
+         files_fstat={} files_uring={} files_decompressed={} files_direct={} \
+         files_direct_fallback={} cache_hits={} cache_misses={} thp_kb={} \
+         kernel={kernel} buf_size={buf_size} threads={threads}",
+        wall.as_secs_f64() * 1e3,
+        IO_WAIT_NS.load(Ordering::Relaxed) as f64 / 1e6,
+        COUNT_NS.load(Ordering::Relaxed) as f64 / 1e6,
+        READ_SYSCALLS.load(Ordering::Relaxed),
+        FILES_MMAP.load(Ordering::Relaxed),
+        FILES_PARALLEL.load(Ordering::Relaxed),
+        FILES_STREAM.load(Ordering::Relaxed),
+        FILES_FSTAT.load(Ordering::Relaxed),
+        FILES_URING.load(Ordering::Relaxed),
+        FILES_DECOMPRESSED.load(Ordering::Relaxed),
+        FILES_DIRECT.load(Ordering::Relaxed),
+        FILES_DIRECT_FALLBACK.load(Ordering::Relaxed),
+        CACHE_HITS.load(Ordering::Relaxed),
+        CACHE_MISSES.load(Ordering::Relaxed),
+        THP_KB.load(Ordering::Relaxed),
+    )
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn disabled_events_cost_nothing_and_record_nothing() {
+        // Stats default off; events must not accumulate.
+        add_bytes(1000);
+        add_read_syscall();
+        bump(Engine::Mmap);
+        let line = report(Duration::from_millis(10), "test", 4096, 1);
+        assert!(line.contains("bytes=0"), "{line}");
+        assert!(line.contains("files_mmap=0"), "{line}");
+    }
+
+    #[test]
+    fn report_is_single_line_key_value() {
+        let line = report(Duration::from_millis(5), "avx2", 262144, 4);
+        assert_eq!(line.lines().count(), 1);
+        assert!(line.starts_with("wc-rs-stats: "));
+        for field in line.trim_start_matches("wc-rs-stats: ").split(' ') {
+            assert!(field.contains('='), "malformed field {field}");
+        }
+        assert!(line.contains("kernel=avx2"));
+        assert!(line.contains("buf_size=262144"));
+        assert!(line.contains("threads=4"));
+    }
+}
@@ -0,0 +1,310 @@
+//! Native UTF-16 counting (BOM-detected, no transcoding).
+//!
+//! Windows-originated corpora arrive as UTF-16LE, and an iconv pass before
+//! counting costs a full extra read and a 2x copy. Files opening with a
+//! UTF-16 BOM are counted in place instead: one pass over the code units
+//! produces `-l` (U+000A units), `-m` (code points: units minus low
+//! surrogates, so astral characters count once), and `-w` (ASCII-range
+//! whitespace separates, the C0/DEL band is neutral, everything else is a
+//! word constituent — the UTF-16 mirror of the byte rules). `-c` stays the
+//! byte size of the file, and the BOM itself counts as one character, both
+//! matching what `iconv | wc` produced.
+//!
+//! Newline and surrogate counting run as SWAR over four code units per
+//! step (a 16-bit lane version of the byte kernels; byte-order handled by
+//! swapping the comparison constants), with the word pass per unit.
+//! Selections with `-L` or custom delimiters fall back to byte counting.
+
+use std::fs::File;
+use std::io::{self, Read};
+
+use crate::counts::{Counts, Selection};
+
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum Endian {
+    Le,
+    Be,
+}
+
+/// Detects a UTF-16 byte-order mark at the start of an input.
+pub fn detect_bom(header: &[u8]) -> Option<Endian> {
+    match header {
+        [0xFF, 0xFE, ..] => Some(Endian::Le),
+        [0xFE, 0xFF, ..] => Some(Endian::Be),
+        _ => None,
+    }
+}
+
+const LANE_LO: u64 = 0x0001_0001_0001_0001;
+const LANE_HI: u64 = 0x8000_8000_8000_8000;
+
+/// 0x8000 per 16-bit lane equal to `pattern`. Carry-free, like
+/// `kernel::swar::zero_mask`: the borrow-rippling `(z - LO) & !z & HI`
+/// form falsely flags the lane after a match when it holds pattern+1,
+/// which double-counted U+000A directly followed by U+000B.
+#[inline]
+fn eq16(w: u64, pattern: u16) -> u64 {
+    let z = w ^ (LANE_LO.wrapping_mul(pattern as u64));
+    let low15 = z & !LANE_HI;
+    !((low15 + !LANE_HI) | z) & LANE_HI
+}
+
+#[inline]
+fn decode(unit: [u8; 2], endian: Endian) -> u16 {
+    match endian {
+        Endian::Le => u16::from_le_bytes(unit),
+        Endian::Be => u16::from_be_bytes(unit),
+    }
+}
+
+#[inline]
+fn is_separator(unit: u16) -> bool {
+    matches!(unit, 0x20 | 0x09 | 0x0A | 0x0B | 0x0C | 0x0D)
+}
+
+#[inline]
+fn is_neutral(unit: u16) -> bool {
+    unit < 0x21 && !is_separator(unit) || unit == 0x7F
+}
+
+/// Streaming UTF-16 counter; carries a split code unit across buffers.
+pub struct Utf16Counter {
+    endian: Endian,
+    selection: Selection,
+    counts: Counts,
+    in_word: bool,
+    carry: Option<u8>,
+}
+
+impl Utf16Counter {
+    pub fn new(endian: Endian, selection: Selection) -> Self {
+        Utf16Counter {
+            endian,
+            selection,
+            counts: Counts::default(),
+            in_word: false,
+            carry: None,
+        }
+    }
+
+    pub fn feed(&mut self, buf: &[u8]) {
+        crate::stats::add_bytes(buf.len() as u64);
+        self.counts.bytes += buf.len() as u64;
+        let mut buf = buf;
+        if let Some(first) = self.carry.take() {
+            if buf.is_empty() {
+                self.carry = Some(first);
+                return;
+            }
+            let rejoined = [first, buf[0]];
+            buf = &buf[1..];
+            self.feed_units(&rejoined);
+        }
+        let (units, tail) = buf.split_at(buf.len() & !1);
+        self.feed_units(units);
+        self.carry = tail.first().copied();
+    }
+
+    /// Counts an even-length run of code units.
+    fn feed_units(&mut self, bytes: &[u8]) {
+        // Newlines and low surrogates by SWAR over 4 lanes; the comparison
+        // constants are byte-swapped for BE so lane-local masking works on
+        // the raw little-endian load.
+        let (newline, surrogate_mask, surrogate) = match self.endian {
+            Endian::Le => (0x000Au16, 0xFC00u16, 0xDC00u16),
+            Endian::Be => (0x0A00u16, 0x00FCu16, 0x00DCu16),
+        };
+        let (chunks, tail) = bytes.split_at(bytes.len() - bytes.len() % 8);
+        for chunk in chunks.chunks_exact(8) {
+            let w = u64::from_le_bytes(chunk.try_into().unwrap());
+            if self.selection.lines {
+                self.counts.lines += eq16(w, newline).count_ones() as u64;
+            }
+            if self.selection.chars {
+                let masked = w & LANE_LO.wrapping_mul(surrogate_mask as u64);
+                self.counts.chars += 4 - eq16(masked, surrogate).count_ones() as u64;
+            }
+        }
+        for unit in tail.chunks_exact(2) {
+            let value = decode([unit[0], unit[1]], self.endian);
+            if self.selection.lines && value == 0x0A {
+                self.counts.lines += 1;
+            }
+            if self.selection.chars && value & 0xFC00 != 0xDC00 {
+                self.counts.chars += 1;
+            }
+        }
+        if self.selection.words {
+            for unit in bytes.chunks_exact(2) {
+                let value = decode([unit[0], unit[1]], self.endian);
+                if is_separator(value) {
+                    self.in_word = false;
+                } else if !self.in_word && !is_neutral(value) {
+                    self.in_word = true;
+                    self.counts.words += 1;
+                }
+            }
+        }
+    }
+
+    /// Final counts; a dangling odd byte counts as one (malformed) char.
+    pub fn finish(mut self) -> Counts {
+        if self.carry.is_some() && self.selection.chars {
+            self.counts.chars += 1;
+        }
+        if !self.selection.lines {
+            self.counts.lines = 0;
+        }
+        if !self.selection.words {
+            self.counts.words = 0;
+        }
+        if !self.selection.bytes {
+            self.counts.bytes = 0;
+        }
+        if !self.selection.chars {
+            self.counts.chars = 0;
+        }
+        self.counts.max_line_length = 0;
+        self.counts
+    }
+}
+
+/// Whether the native UTF-16 path can serve this selection: `-L` and any
+/// delimiter override (word set or line byte) keep byte semantics, since
+/// this counter only knows the standard rules over code units.
+pub fn supports(selection: Selection) -> bool {
+    !selection.max_line_length
+        && !crate::counts::custom_word_delims_active()
+        && crate::counts::delims().line == b'\n'
+}
+
+/// Counts an opened UTF-16 file (BOM already detected).
+pub fn count_file(file: &mut File, endian: Endian, selection: Selection) -> io::Result<Counts> {
+    let mut counter = Utf16Counter::new(endian, selection);
+    let mut buf = vec![0u8; crate::input::BUF_SIZE];
+    loop {
+        match file.read(&mut buf) {
+            Ok(0) => break,
+            Ok(n) => counter.feed(&buf[..n]),
+            Err(e) if e.kind() == io::ErrorKind::Interrupted => continue,
+            Err(e) => return Err(e),
+        }
+    }
+    Ok(counter.finish())
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn encode(text: &str, endian: Endian) -> Vec<u8> {
+        let mut bytes = Vec::new();
+        let units = std::iter::once(0xFEFFu16).chain(text.encode_utf16());
+        for unit in units {
+            bytes.extend_from_slice(&match endian {
+                Endian::Le => unit.to_le_bytes(),
+                Endian::Be => unit.to_be_bytes(),
+            });
+        }
+        bytes
+    }
+
+    fn count(text: &str, endian: Endian, chunk: usize) -> Counts {
+        let selection = Selection {
+            lines: true,
+            words: true,
+            bytes: true,
+            chars: true,
+            max_line_length: false,
+        };
+        let data = encode(text, endian);
+        let mut counter = Utf16Counter::new(endian, selection);
+        for piece in data.chunks(chunk) {
+            counter.feed(piece);
+        }
+        counter.finish()
+    }
+
+    const TEXT: &str = "hello wide 日本語 world\nsecond line with 𝄞 clef\n";
+
+    #[test]
+    fn counts_match_utf8_semantics_both_endians() {
+        // Expected: same lines/words as the UTF-8 text, chars = code points
+        // plus the BOM, bytes = encoded size.
+        let expected_chars = TEXT.chars().count() as u64 + 1;
+        for endian in [Endian::Le, Endian::Be] {
+            let counts = count(TEXT, endian, usize::MAX);
+            assert_eq!(counts.lines, 2, "{endian:?}");
+            assert_eq!(counts.words, 9, "{endian:?}");
+            assert_eq!(counts.chars, expected_chars, "{endian:?}");
+            assert_eq!(counts.bytes, encode(TEXT, endian).len() as u64);
+        }
+    }
+
+    #[test]
+    fn split_code_units_across_every_chunk_size() {
+        let reference = count(TEXT, Endian::Le, usize::MAX);
+        for chunk in 1..16 {
+            assert_eq!(count(TEXT, Endian::Le, chunk), reference, "chunk={chunk}");
+        }
+    }
+
+    #[test]
+    fn newline_followed_by_vertical_tab_counts_once() {
+        // U+000A adjacent to U+000B exercised at every lane position: the
+        // borrow-rippling compare this replaced reported 3 lines for 2.
+        let counts = count("a\n\u{b}b\n\u{b}\n\u{b}c", Endian::Le, usize::MAX);
+        assert_eq!(counts.lines, 3);
+        for pad in 0..4 {
+            let text = format!("{}\n\x0Bx", "p".repeat(pad));
+            assert_eq!(count(&text, Endian::Le, usize::MAX).lines, 1, "pad={pad}");
+            assert_eq!(count(&text, Endian::Be, usize::MAX).lines, 1, "pad={pad}");
+        }
+    }
+
+    #[test]
+    fn surrogate_count_is_exact_across_adjacent_unit_values() {
+        // The surrogate path was previously safe only because masked lane
+        // values cannot land on pattern+1; pin it against the decoded
+        // reference over every adjacent pair of interesting units.
+        let units: Vec<u16> = (0xD7FE..=0xE001).chain([0x000A, 0x000B, 0xDBFF]).collect();
+        let mut data = Vec::new();
+        for &a in &units {
+            for &b in &units {
+                data.extend_from_slice(&a.to_le_bytes());
+                data.extend_from_slice(&b.to_le_bytes());
+            }
+        }
+        let selection = Selection {
+            chars: true,
+            lines: true,
+            ..Selection::default()
+        };
+        let mut counter = Utf16Counter::new(Endian::Le, selection);
+        counter.feed(&data);
+        let counts = counter.finish();
+        let decoded: Vec<u16> = data
+            .chunks_exact(2)
+            .map(|u| u16::from_le_bytes([u[0], u[1]]))
+            .collect();
+        let expected_chars = decoded.iter().filter(|&&u| u & 0xFC00 != 0xDC00).count() as u64;
+        let expected_lines = decoded.iter().filter(|&&u| u == 0x000A).count() as u64;
+        assert_eq!(counts.chars, expected_chars);
+        assert_eq!(counts.lines, expected_lines);
+    }
+
+    #[test]
+    fn surrogate_pairs_count_once() {
+        // U+1D11E musical clef: one char from two units.
+        let counts = count("𝄞\n", Endian::Le, usize::MAX);
+        assert_eq!(counts.chars, 3); // BOM + clef + newline
+        assert_eq!(counts.words, 1);
+    }
+
+    #[test]
+    fn bom_detection() {
+        assert_eq!(detect_bom(&[0xFF, 0xFE, 0x41, 0x00]), Some(Endian::Le));
+        assert_eq!(detect_bom(&[0xFE, 0xFF, 0x00, 0x41]), Some(Endian::Be));
+        assert_eq!(detect_bom(b"plain text"), None);
+    }
+}
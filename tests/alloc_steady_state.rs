@@ -0,0 +1,72 @@
+//! Proves the multi-file pipeline is allocation-flat in its steady state:
+//! counting N files must allocate O(workers), not O(N).
+
+use std::alloc::{GlobalAlloc, Layout, System};
+use std::sync::atomic::{AtomicU64, Ordering};
+
+struct CountingAlloc;
+
+static ALLOCATIONS: AtomicU64 = AtomicU64::new(0);
+
+unsafe impl GlobalAlloc for CountingAlloc {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+        System.alloc(layout)
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        System.dealloc(ptr, layout)
+    }
+
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+        System.realloc(ptr, layout, new_size)
+    }
+}
+
+#[global_allocator]
+static ALLOC: CountingAlloc = CountingAlloc;
+
+#[test]
+fn scheduler_steady_state_is_allocation_flat() {
+    const FILES: usize = 2000;
+    let dir = std::env::temp_dir().join(format!("wc-rs-alloc-{}", std::process::id()));
+    std::fs::create_dir_all(&dir).unwrap();
+    let paths: Vec<String> = (0..FILES)
+        .map(|i| {
+            let path = dir.join(format!("f{i}"));
+            std::fs::write(&path, b"a few words on a line\n").unwrap();
+            path.to_string_lossy().into_owned()
+        })
+        .collect();
+    let refs: Vec<&std::path::Path> = paths
+        .iter()
+        .map(|p| std::path::Path::new(p.as_str()))
+        .collect();
+
+    let selection = wc::counts::Selection::default_counters();
+    let opts = wc::input::IoOptions {
+        threads: 4,
+        ..Default::default()
+    };
+
+    // Warm-up run: one-time setup (thread stacks, buffers, lazy statics).
+    let mut warm = 0u64;
+    wc::scheduler::count_files(&refs, selection, opts, |_, r| warm += r.unwrap().words);
+
+    // Measured run: everything reusable is reused now, so the remaining
+    // allocations must not scale with the file count. Thread spawns and
+    // per-batch bookkeeping stay well under one allocation per ten files.
+    let before = ALLOCATIONS.load(Ordering::Relaxed);
+    let mut words = 0u64;
+    wc::scheduler::count_files(&refs, selection, opts, |_, r| words += r.unwrap().words);
+    let during = ALLOCATIONS.load(Ordering::Relaxed) - before;
+
+    assert_eq!(words, 6 * FILES as u64);
+    assert!(
+        during < (FILES / 10) as u64,
+        "steady state allocated {during} times for {FILES} files"
+    );
+
+    std::fs::remove_dir_all(&dir).unwrap();
+}
@@ -0,0 +1,142 @@
+//! Engine-parity torture tests: every engine must agree on adversarial
+//! inputs, and streamed counting must survive files mutating underneath.
+
+use std::fs::File;
+use std::io::Write;
+use std::path::PathBuf;
+
+use wc::counts::{Counter, Counts, Selection};
+use wc::input::{self, IoOptions, BUF_SIZE, MMAP_THRESHOLD};
+
+fn all_but_max_line() -> Selection {
+    Selection {
+        lines: true,
+        words: true,
+        bytes: true,
+        chars: true,
+        max_line_length: false,
+    }
+}
+
+fn temp(name: &str, contents: &[u8]) -> PathBuf {
+    let path = std::env::temp_dir().join(format!("wc-rs-torture-{}-{name}", std::process::id()));
+    std::fs::write(&path, contents).unwrap();
+    path
+}
+
+fn reference(contents: &[u8], selection: Selection) -> Counts {
+    let mut counter = Counter::new(selection);
+    counter.feed(contents);
+    counter.finish()
+}
+
+/// Words and UTF-8 sequences planted to straddle every boundary the
+/// engines use: read-buffer edges, mmap feed edges, and parallel chunk
+/// edges.
+fn boundary_corpus() -> Vec<u8> {
+    let mut data = Vec::with_capacity(2 * MMAP_THRESHOLD as usize + 64);
+    let filler = "word ünïcode 日本 \x01neutral\x01 mix\n";
+    while data.len() < 2 * MMAP_THRESHOLD as usize {
+        // Land a word exactly across the next power-of-two-ish boundary.
+        let next_boundary = (data.len() / BUF_SIZE + 1) * BUF_SIZE;
+        while data.len() < next_boundary.saturating_sub(3) {
+            data.extend_from_slice(filler.as_bytes());
+        }
+        data.extend_from_slice("straddle𝄞".as_bytes());
+    }
+    data
+}
+
+#[test]
+fn every_engine_agrees_on_boundary_corpus() {
+    let selection = all_but_max_line();
+    let data = boundary_corpus();
+    let expected = reference(&data, selection);
+    let path = temp("engines", &data);
+
+    let mut buf = vec![0u8; BUF_SIZE];
+    // Streaming read loop.
+    let streamed =
+        input::count_reader(&mut File::open(&path).unwrap(), selection, &mut buf).unwrap();
+    assert_eq!(streamed, expected, "stream");
+    // mmap (serial) and the parallel chunk engine.
+    for threads in [1, 3, 8] {
+        let opts = IoOptions {
+            threads,
+            ..Default::default()
+        };
+        let counts =
+            input::count_file(&mut File::open(&path).unwrap(), selection, opts, &mut buf).unwrap();
+        assert_eq!(counts, expected, "threads={threads}");
+    }
+    // io_uring, where compiled and permitted.
+    #[cfg(all(target_os = "linux", feature = "io_uring"))]
+    {
+        let file = File::open(&path).unwrap();
+        let len = file.metadata().unwrap().len();
+        if let Some(counts) = wc::uring::try_count_file(&file, len, selection).unwrap() {
+            assert_eq!(counts, expected, "uring");
+        }
+    }
+
+    std::fs::remove_file(&path).unwrap();
+}
+
+#[test]
+fn full_selection_agrees_between_stream_and_mmap() {
+    let selection = Selection {
+        max_line_length: true,
+        ..all_but_max_line()
+    };
+    let data = boundary_corpus();
+    let expected = reference(&data, selection);
+    let path = temp("full-sel", &data);
+    let mut buf = vec![0u8; BUF_SIZE];
+    let streamed =
+        input::count_reader(&mut File::open(&path).unwrap(), selection, &mut buf).unwrap();
+    let mapped = input::count_file(
+        &mut File::open(&path).unwrap(),
+        selection,
+        IoOptions::default(),
+        &mut buf,
+    )
+    .unwrap();
+    assert_eq!(streamed, expected);
+    assert_eq!(mapped, expected);
+    std::fs::remove_file(&path).unwrap();
+}
+
+#[test]
+fn streaming_survives_concurrent_truncation_and_growth() {
+    // A sub-mmap-threshold file streams via read(2); mutating it mid-count
+    // must never panic or hang, whatever counts come out.
+    let path = temp("mutate", &b"mutating line\n".repeat(4096));
+    let writer_path = path.clone();
+    let stop = std::sync::atomic::AtomicBool::new(false);
+
+    std::thread::scope(|scope| {
+        scope.spawn(|| {
+            while !stop.load(std::sync::atomic::Ordering::Relaxed) {
+                let mut file = std::fs::OpenOptions::new()
+                    .append(true)
+                    .open(&writer_path)
+                    .unwrap();
+                let _ = file.write_all(b"grow\n");
+                let _ = file.set_len(1000);
+            }
+        });
+        let mut buf = vec![0u8; 4096];
+        for _ in 0..50 {
+            let counts = input::count_reader(
+                &mut File::open(&path).unwrap(),
+                all_but_max_line(),
+                &mut buf,
+            )
+            .unwrap();
+            // Sanity only: byte count equals whatever was actually read.
+            assert!(counts.bytes >= counts.lines);
+        }
+        stop.store(true, std::sync::atomic::Ordering::Relaxed);
+    });
+    std::fs::remove_file(&path).unwrap();
+}